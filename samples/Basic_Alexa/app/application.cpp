@@ -3,6 +3,8 @@
 #include <Hue/Bridge.h>
 #include <Hue/DeviceList.h>
 #include <Hue/ColourDevice.h>
+#include <Hue/SimulatedDevice.h>
+#include <Hue/Entertainment.h>
 #include <MyHueDevice.h>
 #include <malloc_count.h>
 
@@ -19,6 +21,12 @@ HttpServer server;
 Hue::DeviceList devices;
 Hue::DeviceListEnumerator enumerator(devices);
 Hue::Bridge bridge(enumerator);
+#if ENABLE_HUE_ENTERTAINMENT
+Hue::Entertainment entertainment(bridge);
+#endif
+#ifdef ARCH_HOST
+Hue::SimulatedLink simulatedLink;
+#endif
 constexpr uint16_t serverPort{80};
 
 constexpr uint8_t LED_PIN{2}; // GPIO2
@@ -62,7 +70,7 @@ void gotIP(IpAddress ip, IpAddress netmask, IpAddress gateway)
 
 	server.listen(serverPort);
 	server.paths.setDefault(onHttpRequest);
-	server.setBodyParser(MIME_JSON, bodyToStringParser);
+	server.setBodyParser(MIME_JSON, Hue::bodyParser);
 	server.setBodyParser(MIME_XML, bodyToStringParser);
 
 	if(!UPnP::deviceHost.begin()) {
@@ -71,6 +79,12 @@ void gotIP(IpAddress ip, IpAddress netmask, IpAddress gateway)
 	}
 
 	UPnP::deviceHost.registerDevice(&bridge);
+	bridge.begin();
+
+#if ENABLE_HUE_ENTERTAINMENT
+	// Accept streamed colour frames on UDP port 2100. There's no authentication, so off by default.
+	entertainment.begin();
+#endif
 
 	/*
 	 * To avoid confusion when testing with a Host or real device, ensure lighting devices are
@@ -94,9 +108,20 @@ void gotIP(IpAddress ip, IpAddress netmask, IpAddress gateway)
 
 	devices.addElement(new Hue::OnOffDevice(256, Name(256)));
 
-	devices.addElement(new Hue::OnOffDevice(500, Name(500)));
-	devices.addElement(new Hue::DimmableDevice(501, Name(501)));
-	devices.addElement(new Hue::ColourDevice(502, Name(502)));
+	/*
+	 * On Host, these devices respond via a simulated link so we can see how the bridge behaves
+	 * with realistic delays and failures.
+	 */
+	auto simulate = [](Hue::Device* device) -> Hue::Device* {
+#ifdef ARCH_HOST
+		return new Hue::SimulatedDevice(device, simulatedLink);
+#else
+		return device;
+#endif
+	};
+	devices.addElement(simulate(new Hue::OnOffDevice(500, Name(500))));
+	devices.addElement(simulate(new Hue::DimmableDevice(501, Name(501))));
+	devices.addElement(simulate(new Hue::ColourDevice(502, Name(502))));
 
 	devices.addElement(new Hue::ColourDevice(54321, Name(54321)));
 	devices.addElement(new Hue::ColourDevice(0x7FFFFFFF, Name(0x7FFFFFFF)));
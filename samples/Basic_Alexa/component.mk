@@ -1,2 +1,7 @@
 ARDUINO_LIBRARIES := HueEmulator
 COMPONENT_DEPENDS := malloc_count
+
+# Accept unauthenticated colour streams on UDP port 2100
+CONFIG_VARS += ENABLE_HUE_ENTERTAINMENT
+ENABLE_HUE_ENTERTAINMENT ?= 0
+APP_CFLAGS += -DENABLE_HUE_ENTERTAINMENT=$(ENABLE_HUE_ENTERTAINMENT)
@@ -59,6 +59,16 @@ public:
 		return Status::pending;
 	}
 
+	// Change was made by other means, so just update cached state
+	bool applyState(Attribute attr, unsigned value) override
+	{
+		if(attr != Attribute::on) {
+			return false;
+		}
+		on = (value != 0);
+		return true;
+	}
+
 private:
 	struct Action {
 		Attribute attr;
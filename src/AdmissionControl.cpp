@@ -0,0 +1,74 @@
+/**
+ * AdmissionControl.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/AdmissionControl.h"
+#include <esp_systemapi.h>
+
+namespace Hue
+{
+AdmissionControl::AdmissionControl()
+	: config{
+		  .maxInFlight =
+			  {
+#define XX(tag, maxInFlight, cost) maxInFlight,
+				  HUE_ADMISSION_TYPE_MAP(XX)
+#undef XX
+			  },
+		  .estimatedCost =
+			  {
+#define XX(tag, maxInFlight, cost) cost,
+				  HUE_ADMISSION_TYPE_MAP(XX)
+#undef XX
+			  },
+		  .minFreeHeap = 8192,
+		  .httpStatus = false,
+	  }
+{
+}
+
+bool AdmissionControl::admit(Type type, Ticket& ticket)
+{
+	auto i = unsigned(type);
+	if(inFlight[i] >= config.maxInFlight[i]) {
+		debug_w("[HUE] Admission refused, %u in flight", inFlight[i]);
+		return false;
+	}
+
+	auto freeHeap = system_get_free_heap_size();
+	if(freeHeap < config.minFreeHeap + config.estimatedCost[i]) {
+		debug_w("[HUE] Admission refused, free heap %u", freeHeap);
+		return false;
+	}
+
+	++inFlight[i];
+	ticket = Ticket();
+	ticket.controller = this;
+	ticket.type = type;
+	return true;
+}
+
+void AdmissionControl::Ticket::release()
+{
+	if(controller != nullptr) {
+		--controller->inFlight[unsigned(type)];
+		controller = nullptr;
+	}
+}
+
+} // namespace Hue
@@ -0,0 +1,141 @@
+/**
+ * Backend.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/Backend.h"
+#include <Platform/System.h>
+
+namespace Hue
+{
+uint8_t Backend::allocate()
+{
+	for(unsigned i = 0; i < queueSize; ++i) {
+		if(slots[i].state == Slot::State::free) {
+			return i;
+		}
+	}
+	return noSlot;
+}
+
+Status Backend::submit(Device::ID id, Device::Attribute attr, unsigned value, Device::Callback callback)
+{
+	auto index = allocate();
+	if(index == noSlot) {
+		++stats.rejected;
+		debug_w("[HUE] Backend queue full");
+		return Status::error;
+	}
+	++stats.submitted;
+
+	auto& slot = slots[index];
+	slot.callback = callback;
+	slot.chain = noSlot;
+
+	// Supersede a queued command for the same attribute
+	for(auto& s : slots) {
+		if(s.state == Slot::State::queued && s.command.id == id && s.command.attr == attr) {
+			s.command.value = value;
+			slot.state = Slot::State::merged;
+			slot.chain = s.chain;
+			s.chain = index;
+			++stats.coalesced;
+			return Status::pending;
+		}
+	}
+
+	slot.command = Command{id, attr, value};
+	slot.sequence = ++sequence;
+	slot.state = Slot::State::queued;
+	pump();
+	return Status::pending;
+}
+
+void Backend::pump()
+{
+	while(inFlight < config.window) {
+		// Oldest queued command goes next
+		Slot* next = nullptr;
+		for(auto& s : slots) {
+			if(s.state == Slot::State::queued && (next == nullptr || int32_t(s.sequence - next->sequence) < 0)) {
+				next = &s;
+			}
+		}
+		if(next == nullptr) {
+			break;
+		}
+		next->state = Slot::State::inFlight;
+		++inFlight;
+		transmitting = true;
+		transmit(next->command, next - slots);
+		transmitting = false;
+	}
+}
+
+void Backend::complete(uint8_t tag, Status status, int errorCode)
+{
+	if(tag >= queueSize || slots[tag].state != Slot::State::inFlight) {
+		debug_e("[HUE] Backend completion for unknown tag %u", tag);
+		return;
+	}
+	--inFlight;
+
+	if(transmitting) {
+		// Caller of `submit()` hasn't seen `pending` yet
+		auto& slot = slots[tag];
+		slot.state = Slot::State::completed;
+		slot.status = status;
+		slot.errorCode = errorCode;
+		if(!flushQueued) {
+			flushQueued = true;
+			System.queueCallback([](void* param) { static_cast<Backend*>(param)->flush(); }, this);
+		}
+		return;
+	}
+
+	finish(tag, status, errorCode);
+	pump();
+}
+
+void Backend::flush()
+{
+	flushQueued = false;
+	for(unsigned i = 0; i < queueSize; ++i) {
+		auto& slot = slots[i];
+		if(slot.state == Slot::State::completed) {
+			finish(i, slot.status, slot.errorCode);
+		}
+	}
+	pump();
+}
+
+void Backend::finish(uint8_t index, Status status, int errorCode)
+{
+	// Release slots before invoking callbacks, which may submit further commands
+	while(index != noSlot) {
+		auto& slot = slots[index];
+		auto callback = slot.callback;
+		index = slot.chain;
+		slot.state = Slot::State::free;
+		slot.callback = nullptr;
+		if(callback) {
+			callback(status, errorCode);
+		}
+	}
+}
+
+} // namespace Hue
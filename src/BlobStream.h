@@ -0,0 +1,79 @@
+/****
+ * BlobStream.h - Read-only stream over a pre-rendered block of data
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <Data/Stream/DataSourceStream.h>
+#include <WString.h>
+#include <memory>
+
+namespace Hue
+{
+/**
+ * @brief Stream content directly from a shared, immutable String
+ * @note No copy is made, so serving the same blob to many clients costs no heap.
+ * The stream holds a reference so the blob survives if its owner replaces it.
+ */
+class BlobStream : public IDataSourceStream
+{
+public:
+	BlobStream(std::shared_ptr<const String> blob) : blob(std::move(blob))
+	{
+	}
+
+	bool isValid() const override
+	{
+		return true;
+	}
+
+	int available() override
+	{
+		return blob->length() - readPos;
+	}
+
+	uint16_t readMemoryBlock(char* data, int bufSize) override
+	{
+		if(bufSize <= 0) {
+			return 0;
+		}
+		auto len = std::min(size_t(bufSize), blob->length() - readPos);
+		memcpy(data, blob->c_str() + readPos, len);
+		return len;
+	}
+
+	bool seek(int len) override
+	{
+		if(len < 0 || readPos + len > blob->length()) {
+			return false;
+		}
+		readPos += len;
+		return true;
+	}
+
+	bool isFinished() override
+	{
+		return readPos >= blob->length();
+	}
+
+private:
+	std::shared_ptr<const String> blob;
+	unsigned readPos{0};
+};
+
+} // namespace Hue
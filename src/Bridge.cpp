@@ -19,7 +19,18 @@
 
 #include "include/Hue/Bridge.h"
 #include "DeviceListStream.h"
+#include "DeviceStatsStream.h"
+#include "SensorListStream.h"
+#include "RuleListStream.h"
+#include "ScheduleListStream.h"
+#include "ConfigStream.h"
+#include "DatastoreStream.h"
+#include "ErrorResponse.h"
+#include "Encoding.h"
+#include "BlobStream.h"
 #include <Platform/Station.h>
+#include <Platform/System.h>
+#include <SystemClock.h>
 #include "ResponseStream.h"
 #include <ArduinoJson.h>
 #include <Data/CStringArray.h>
@@ -31,6 +42,7 @@ namespace Hue
 void Bridge::getStatusInfo(JsonObject json)
 {
 	stats.serialize(json);
+	deviceStats.serializeSummary(json);
 	auto jusers = json.createNestedObject(FS_users);
 	for(unsigned i = 0; i < users.count(); ++i) {
 		auto& username = users.keyAt(i);
@@ -42,15 +54,273 @@ void Bridge::getStatusInfo(JsonObject json)
 	}
 }
 
+void Bridge::deviceStateChanged(const Hue::Device& device, Hue::Device::Attributes changed)
+{
+	snapshot.changed();
+
+	// Rule evaluation may look up other devices, which can recycle `device`, so notify first
+	auto id = device.getId();
+	notifyStateChange(device, changed);
+
+	// Changes made by rule actions are not evaluated again
+	if(rules && !rules->isDispatching()) {
+		rules->lightChanged(id, changed);
+	}
+}
+
+void Bridge::notifyStateChange(const Hue::Device& device, Hue::Device::Attributes changed)
+{
+	if(!stateChangeDelegate) {
+		return;
+	}
+
+	if(notifyWindow == 0) {
+		stateChangeDelegate(device, changed);
+		return;
+	}
+
+	// Merge with existing notification for this device
+	auto id = device.getId();
+	for(unsigned i = 0; i < pendingChangeCount; ++i) {
+		auto& pc = pendingChanges[i];
+		if(pc.id == id) {
+			pc.changed += changed;
+			return;
+		}
+	}
+
+	if(pendingChangeCount == HUE_NOTIFY_QUEUE_SIZE) {
+		flushStateChanges();
+	}
+	pendingChanges[pendingChangeCount++] = PendingChange{id, changed};
+
+	if(!notifyTimer.isStarted()) {
+		notifyTimer.initializeMs(notifyWindow, TimerDelegate(&Bridge::flushStateChanges, this));
+		notifyTimer.startOnce();
+	}
+}
+
+void Bridge::setNotifyWindow(uint16_t window)
+{
+	notifyWindow = window;
+	if(window == 0) {
+		flushStateChanges();
+		pendingChanges.reset();
+	} else if(!pendingChanges) {
+		pendingChanges.reset(new PendingChange[HUE_NOTIFY_QUEUE_SIZE]);
+		if(!pendingChanges) {
+			notifyWindow = 0;
+		}
+	}
+}
+
+void Bridge::flushStateChanges()
+{
+	notifyTimer.stop();
+
+	auto count = pendingChangeCount;
+	if(count == 0) {
+		return;
+	}
+
+	// Callbacks may cause further changes, so take a copy first
+	PendingChange changes[HUE_NOTIFY_QUEUE_SIZE];
+	memcpy(changes, pendingChanges.get(), count * sizeof(PendingChange));
+	pendingChangeCount = 0;
+
+	for(unsigned i = 0; i < count; ++i) {
+		auto device = devices.find(changes[i].id);
+		if(device != nullptr && stateChangeDelegate) {
+			stateChangeDelegate(*device, changes[i].changed);
+		}
+	}
+}
+
+bool Bridge::postStateUpdate(Device::ID id, Device::Attribute attr, unsigned value)
+{
+	if(!events || !events->push(StateUpdate{id, attr, value})) {
+		return false;
+	}
+
+	// Only one task callback required per batch
+	if(!eventsScheduled.exchange(true)) {
+		if(!System.queueCallback([](void* param) { static_cast<Bridge*>(param)->processStateUpdates(); }, this)) {
+			// Task queue full: update stays queued and next post tries again
+			debug_w("[HUE] Failed to schedule state updates");
+			eventsScheduled = false;
+		}
+	}
+	return true;
+}
+
+void Bridge::processStateUpdates()
+{
+	eventsScheduled = false;
+
+	// Merge updates for each device so it gets one notification per batch
+	Device* device{nullptr};
+	Device::Attributes changed;
+	auto notify = [&]() {
+		if(device != nullptr && changed.any()) {
+			deviceStateChanged(*device, changed);
+		}
+		device = nullptr;
+		changed = Device::Attributes{};
+	};
+
+	StateUpdate update;
+	while(events->pop(update)) {
+		if(device != nullptr && device->getId() != update.id) {
+			notify();
+		}
+		if(device == nullptr) {
+			device = devices.find(update.id);
+			if(device == nullptr) {
+				debug_w("[HUE] State update for unknown device #%u", update.id);
+				continue;
+			}
+		}
+		if(device->applyState(update.attr, update.value)) {
+			changed[update.attr] = true;
+		}
+	}
+
+	notify();
+}
+
+void Bridge::setSensors(Sensor::Enumerator& sensors)
+{
+	this->sensors = &sensors;
+	sensors.reset();
+	Sensor* sensor;
+	while((sensor = sensors.next()) != nullptr) {
+		sensor->onChange([this](Sensor& sensor) {
+			if(rules) {
+				rules->sensorChanged(sensor);
+			}
+		});
+	}
+}
+
+void Bridge::begin()
+{
+	updateIdentity();
+}
+
+const Bridge::Identity& Bridge::getIdentity() const
+{
+	if(WifiStation.getIP() != identity.ipaddr || !identity.description) {
+		updateIdentity();
+	}
+	return identity;
+}
+
+void Bridge::updateIdentity() const
+{
+	auto& id = identity;
+	id.ipaddr = WifiStation.getIP();
+
+	id.friendlyName = F("Philips hue (");
+	id.friendlyName += id.ipaddr.toString();
+	if(instance != 0) {
+		id.friendlyName += '#';
+		id.friendlyName += instance;
+	}
+	id.friendlyName += ')';
+
+	id.serialNumber = WifiStation.getMAC();
+	if(instance != 0) {
+		// Virtual bridges get a locally-administered variant of the MAC address
+		uint8_t octet = (WifiStation.getMacAddress()[0] ^ (instance << 2)) | 0x02;
+		id.serialNumber[0] = hexchar(octet >> 4);
+		id.serialNumber[1] = hexchar(octet & 0x0f);
+	}
+
+	id.udn = F("uuid:2f402f80-da50-11e1-9b23-");
+	id.udn += id.serialNumber;
+
+	id.bridgeId = id.serialNumber.substring(0, 6);
+	id.bridgeId += F("FFFE");
+	id.bridgeId += id.serialNumber.substring(6);
+	id.bridgeId.toUpperCase();
+
+	id.descriptionPath = Device::getField(Field::descriptionURL);
+	if(id.descriptionPath[0] != '/') {
+		id.descriptionPath = '/' + id.descriptionPath;
+	}
+
+	/*
+	 * Render description.xml once. The content only depends on identity so we can serve the same
+	 * blob to every client, and discovery storms cost no more than a memcpy.
+	 */
+	String xml = F("<?xml version=\"1.0\" ?>\r\n"
+			"<root xmlns=\"urn:schemas-upnp-org:device-1-0\">"
+			"<specVersion><major>1</major><minor>0</minor></specVersion>");
+	auto addField = [&](const String& tag, const String& value) {
+		xml += '<';
+		xml += tag;
+		xml += '>';
+		xml += value;
+		xml += F("</");
+		xml += tag;
+		xml += '>';
+	};
+	addField(F("URLBase"), Device::getField(Field::URLBase) + pathPrefix.substring(1));
+	xml += F("<device>");
+	addField(F("deviceType"), getField(Field::deviceType));
+	addField(F("friendlyName"), id.friendlyName);
+	addField(F("manufacturer"), getField(Field::manufacturer));
+	addField(F("manufacturerURL"), getField(Field::manufacturerURL));
+	addField(F("modelDescription"), getField(Field::modelDescription));
+	addField(F("modelName"), getField(Field::modelName));
+	addField(F("modelNumber"), getField(Field::modelNumber));
+	addField(F("modelURL"), getField(Field::modelURL));
+	addField(F("serialNumber"), id.serialNumber);
+	addField(F("UDN"), id.udn);
+	addField(F("presentationURL"), F("index.html"));
+	xml += F("</device></root>\r\n");
+
+	// FNV-1a
+	uint32_t hash = 2166136261U;
+	for(unsigned i = 0; i < xml.length(); ++i) {
+		hash = (hash ^ uint8_t(xml[i])) * 16777619U;
+	}
+	char etag[11];
+	m_snprintf(etag, sizeof(etag), "\"%08x\"", hash);
+	id.etag = etag;
+
+	// Responses still streaming the previous blob keep their own reference to it
+	id.description = std::make_shared<const String>(std::move(xml));
+
+	debug_i("[HUE] Identity updated: %s, bridgeid %s, description %u bytes", id.friendlyName.c_str(),
+			id.bridgeId.c_str(), id.description->length());
+}
+
+void Bridge::getConfig(JsonObject json)
+{
+	auto& id = getIdentity();
+	json[FS_name] = F("Philips hue");
+	json[FS_zigbeechannel] = 15;
+	json[FS_bridgeid] = id.bridgeId;
+	json[FS_mac] = WifiStation.getMAC(':');
+	json[FS_dhcp] = WifiStation.isEnabledDHCP();
+	json[FS_ipaddress] = id.ipaddr.toString();
+	json[FS_netmask] = WifiStation.getNetworkMask().toString();
+	json[FS_gateway] = WifiStation.getNetworkGateway().toString();
+	json[FS_UTC] = DateTime(SystemClock.now(eTZ_UTC)).toISO8601();
+	json[FS_localtime] = DateTime(SystemClock.now(eTZ_Local)).toISO8601();
+	json[FS_modelid] = F("BSB002");
+	json[FS_swversion] = F("1935144020");
+	json[FS_apiversion] = F("1.17.0");
+	json[FS_linkbutton] = pairingEnabled;
+	json[FS_portalservices] = false;
+}
+
 String Bridge::getField(Field desc) const
 {
 	switch(desc) {
-	case Field::friendlyName: {
-		String s = F("Philips hue (");
-		s += WifiStation.getIP().toString();
-		s += ')';
-		return s;
-	}
+	case Field::friendlyName:
+		return getIdentity().friendlyName;
 	case Field::manufacturer:
 		return F("Royal Philips Electronics");
 	case Field::manufacturerURL:
@@ -64,9 +334,9 @@ String Bridge::getField(Field desc) const
 	case Field::modelURL:
 		return F("http://www.meethue.com");
 	case Field::serialNumber:
-		return WifiStation.getMAC();
+		return getIdentity().serialNumber;
 	case Field::UDN:
-		return F("uuid:2f402f80-da50-11e1-9b23-") + getField(Field::serialNumber);
+		return getIdentity().udn;
 	case Field::productNameAndVersion:
 		return F("IpBridge/1.17.0");
 	default:
@@ -76,7 +346,19 @@ String Bridge::getField(Field desc) const
 
 bool Bridge::formatMessage(SSDP::Message& msg, SSDP::MessageSpec& ms)
 {
-	msg[F("hue-bridgeid")] = WifiStation.getMAC();
+	switch(ssdpScheduler.check(ms)) {
+	case SsdpScheduler::Action::send:
+		break;
+	case SsdpScheduler::Action::defer:
+		++stats.ssdp.deferred;
+		return false;
+	case SsdpScheduler::Action::drop:
+		++stats.ssdp.dropped;
+		return false;
+	}
+
+	++stats.ssdp.count;
+	msg[F("hue-bridgeid")] = getIdentity().bridgeId;
 	return Device::formatMessage(msg, ms);
 }
 
@@ -85,33 +367,49 @@ void Bridge::configure(const Config& config)
 	switch(config.type) {
 	case Config::Type::AuthorizeUser: {
 		auto& user = users[config.name];
+		if(user.authorized && user.deviceType == config.deviceType) {
+			return;
+		}
 		user.deviceType = config.deviceType;
 		user.authorized = true;
 		debug_i("[HUE] Created user, devicetype = '%s', name = '%s'", user.deviceType.c_str(), config.name.c_str());
+		if(journal.isOpen()) {
+			journal.append(UserJournal::RecordType::authorize, config.name, config.deviceType, users);
+		}
 		break;
 	}
 
 	case Config::Type::RevokeUser: {
-		auto& user = users[config.name];
-		user.authorized = false;
-		debug_i("[HUE] Revoke user, devicetype = '%s', name = '%s'", user.deviceType.c_str(), config.name.c_str());
+		int i = users.indexOf(config.name);
+		if(i < 0) {
+			debug_w("[HUE] Revoke unknown user '%s'", config.name.c_str());
+			return;
+		}
+		debug_i("[HUE] Revoke user, devicetype = '%s', name = '%s'", users.valueAt(i).deviceType.c_str(),
+				config.name.c_str());
+		// Removed rather than marked unauthorized, so the table matches what the journal replays
+		users.remove(config.name);
+		if(journal.isOpen()) {
+			journal.append(UserJournal::RecordType::revoke, config.name, String(), users);
+		}
 		break;
 	}
 	}
 }
 
-void Bridge::createUser(JsonObjectConst request, JsonDocument& result, const String& requestPath)
+void Bridge::enableUserJournal(const String& filename)
 {
-	if(!pairingEnabled) {
-		createError(result, requestPath, Error::LinkButtonNotPressed, nullptr);
-		return;
-	}
+	journal.open(filename);
+	journal.replay(users);
+}
 
+void Bridge::createUser(const RequestBody& request, JsonDocument& result)
+{
 	uint8_t name[16];
 	os_get_random(name, sizeof(name));
 	Config cfg{
 		.type = Config::Type::AuthorizeUser,
-		.deviceType = request[_F("devicetype")].as<const char*>(),
+		.deviceType = request.deviceType,
 		.name = makeHexString(name, sizeof(name)),
 	};
 
@@ -127,18 +425,18 @@ void Bridge::createUser(JsonObjectConst request, JsonDocument& result, const Str
 	obj[_F("username")] = cfg.name;
 }
 
-bool Bridge::validateUser(const char* userName)
+User* Bridge::validateUser(const char* userName)
 {
 	// If user doesn't exist, will create a default un-authorized entry
 	auto& user = users[userName];
 	++user.count;
 
 	if(user.authorized) {
-		return true;
+		return &user;
 	}
 
 	if(!pairingEnabled) {
-		return false;
+		return nullptr;
 	}
 
 	debug_i("In pairing mode, storing provided username '%s'", userName);
@@ -152,7 +450,7 @@ bool Bridge::validateUser(const char* userName)
 		configDelegate(config);
 	}
 
-	return true;
+	return &users[userName];
 }
 
 /*
@@ -201,13 +499,19 @@ bool Bridge::onHttpRequest(HttpServerConnection& connection)
 {
 	++stats.request.count;
 
+	auto& path = connection.getRequest()->uri.Path;
+	if(path == getIdentity().descriptionPath || (instance == 0 && path == F("/description.xml"))) {
+		++stats.request.root;
+		sendDescription(connection);
+		return true;
+	}
+
 	if(Device::onHttpRequest(connection)) {
 		++stats.request.root;
 		return true;
 	}
 
-	auto request = connection.getRequest();
-	if(!request->uri.Path.startsWith("/api")) {
+	if(!path.startsWith(pathPrefix) || strncmp(path.c_str() + pathPrefix.length(), "api", 3) != 0) {
 		++stats.request.ignored;
 		return false;
 	}
@@ -217,10 +521,28 @@ bool Bridge::onHttpRequest(HttpServerConnection& connection)
 	return true;
 }
 
+void Bridge::sendDescription(HttpServerConnection& connection)
+{
+	auto& id = getIdentity();
+	auto& request = *connection.getRequest();
+	auto& response = *connection.getResponse();
+
+	response.headers[HTTP_HEADER_ETAG] = id.etag;
+	if(request.headers[F("If-None-Match")] == id.etag) {
+		response.code = HTTP_STATUS_NOT_MODIFIED;
+		return;
+	}
+
+	// Content-Length is set from available()
+	response.sendDataStream(new BlobStream(id.description), MIME_XML);
+	++stats.response.count;
+	stats.response.size += id.description->length();
+}
+
 void Bridge::handleApiRequest(HttpServerConnection& connection)
 {
 	auto& request = *connection.getRequest();
-	String requestPath = request.uri.getRelativePath();
+	String requestPath = request.uri.Path.substring(pathPrefix.length());
 	debug_i("[HUE] Request: %s %s", toString(request.method), requestPath.c_str());
 
 	auto badRequest = [&]() -> void {
@@ -228,20 +550,61 @@ void Bridge::handleApiRequest(HttpServerConnection& connection)
 		++stats.error.count;
 	};
 
+	// Binary encoding is offered for light requests only, and errors are always JSON
+	auto requestedEncoding = getEncoding(request);
+	Encoding encoding{Encoding::json};
+
 	auto sendStream = [&](IDataSourceStream* stream, size_t len) -> void {
-		connection.getResponse()->sendDataStream(stream, MIME_JSON);
+		connection.getResponse()->sendDataStream(stream, getContentType(encoding));
 		++stats.response.count;
 		stats.response.size += len;
 	};
 
-	auto body = request.getBodyStream();
-	int avail = 0;
-	if(body != nullptr) {
-		avail = body->available();
-		if(avail < 0 || body->getStreamType() != eSST_Memory) {
-			debug_e("[HUE] Invalid request body");
-			return badRequest();
+	auto throttled = [&]() -> void {
+		auto response = connection.getResponse();
+		response->code = HTTP_STATUS_TOO_MANY_REQUESTS;
+		response->headers[F("Retry-After")] = "1";
+		++stats.error.throttled;
+	};
+
+	// Parser slot must be released however the request completes, including when throttled
+	struct BodyGuard {
+		const HttpRequest& request;
+		~BodyGuard()
+		{
+			RequestBody::release(request);
 		}
+	} bodyGuard{request};
+
+	// Reject misbehaving clients before doing any real work
+	if(!rateLimiter.checkAddress(connection.getRemoteIp())) {
+		debug_w("[HUE] Throttled %s", connection.getRemoteIp().toString().c_str());
+		return throttled();
+	}
+
+	// Body has either been parsed already by `bodyParser`, or buffered by `bodyToStringParser`
+	RequestBody bufferedBody;
+	auto body = RequestBody::get(request);
+	if(body == nullptr) {
+		body = &bufferedBody;
+		bufferedBody.begin();
+		auto stream = request.getBodyStream();
+		if(stream != nullptr) {
+			int avail = stream->available();
+			if(avail < 0 || stream->getStreamType() != eSST_Memory) {
+				debug_e("[HUE] Invalid request body");
+				return badRequest();
+			}
+			debug_d("[HUE] Body: %d bytes", avail);
+			auto mem = reinterpret_cast<MemoryDataStream*>(stream);
+			auto data = mem->getStreamPointer();
+#if DEBUG_VERBOSE_LEVEL == INFO
+			m_nputs(data, avail);
+			m_putc('\n');
+#endif
+			bufferedBody.parse(data, avail);
+		}
+		bufferedBody.end();
 	}
 
 	requestPath.replace('/', '\0');
@@ -258,41 +621,88 @@ void Bridge::handleApiRequest(HttpServerConnection& connection)
 		requestPath += segments[i];
 	}
 
-	StaticJsonDocument<128> requestDoc;
-	if(avail > 0) {
-		debug_d("[HUE] Body: %d bytes", avail);
-		auto mem = reinterpret_cast<MemoryDataStream*>(body);
-		auto data = const_cast<char*>(mem->getStreamPointer());
-#if DEBUG_VERBOSE_LEVEL == INFO
-		m_nputs(data, avail);
-		m_putc('\n');
-#endif
-		Json::deserialize(requestDoc, data, avail);
-	}
-
 	StaticJsonDocument<2048> resultDoc;
 
 	auto sendResult = [&]() {
 		auto stream = new MemoryDataStream;
-		auto len = Json::serialize(resultDoc, stream);
+		auto len = serialize(resultDoc, *stream, encoding);
+		return sendStream(stream, len);
+	};
+
+	using Admission = AdmissionControl::Type;
+	AdmissionControl::Ticket ticket;
+
+	auto sendChunked = [&](ChunkedStream* stream) {
+		stream->ticket = std::move(ticket);
+		stream->setSlicing(sliceBudget, &stats.slice, &connection);
+		return sendStream(stream, 0);
+	};
+
+	auto sendError = [&](Error error, const ErrorArgs& args) {
+		encoding = Encoding::json;
+		auto stream = new MemoryDataStream;
+		auto len = writeErrorResponse(*stream, error, requestPath.c_str(), args);
 		return sendStream(stream, len);
 	};
 
 	auto resourceNotAvailable = [&]() {
 		++stats.error.resourceNotAvailable;
-		String s = toString(Error::ResourceNotAvailable);
-		s.replace(F("<resource>"), requestPath);
-		createError(resultDoc, requestPath, Error::ResourceNotAvailable, s);
-		return sendResult();
+		return sendError(Error::ResourceNotAvailable, ErrorArgs().set(ErrorArg::resource, requestPath.c_str()));
 	};
 
 	auto methodNotAvailable = [&]() {
 		++stats.error.methodNotAvailable;
-		String s = toString(Error::MethodNotAvailable);
-		s.replace(F("<method_name>"), toString(request.method));
-		s.replace(F("<resource>"), requestPath);
-		createError(resultDoc, requestPath, Error::MethodNotAvailable, s);
-		return sendResult();
+		String method = toString(request.method);
+		ErrorArgs args;
+		args.set(ErrorArg::method_name, method.c_str());
+		args.set(ErrorArg::resource, requestPath.c_str());
+		return sendError(Error::MethodNotAvailable, args);
+	};
+
+	auto busy = [&](Admission type) {
+		++stats.rejected[unsigned(type)];
+		if(admission.getConfig().httpStatus) {
+			auto response = connection.getResponse();
+			response->code = HTTP_STATUS_SERVICE_UNAVAILABLE;
+			response->headers[F("Retry-After")] = "1";
+			return;
+		}
+		return sendError(Error::InternalError, ErrorArgs().set(ErrorArg::error_code, "503"));
+	};
+
+	if(body->error) {
+		++stats.error.count;
+		return sendError(Error::InvalidJson, ErrorArgs());
+	}
+	if(body->overflow) {
+		// Silently dropping parameters would apply a partial update
+		debug_w("[HUE] Request body exceeds parser limits");
+		++stats.error.count;
+		return sendError(Error::InvalidJson, ErrorArgs());
+	}
+
+	// Rule and schedule definitions are nested so body is buffered rather than parsed by `bodyParser`
+	auto parseJsonBody = [&](JsonDocument& doc) -> bool {
+		auto stream = request.getBodyStream();
+		if(stream == nullptr || stream->getStreamType() != eSST_Memory) {
+			sendError(Error::MissingParameters, ErrorArgs());
+			return false;
+		}
+		auto mem = reinterpret_cast<MemoryDataStream*>(stream);
+		if(deserializeJson(doc, mem->getStreamPointer(), mem->available()) != DeserializationError::Ok ||
+		   !doc.is<JsonObject>()) {
+			++stats.error.count;
+			sendError(Error::InvalidJson, ErrorArgs());
+			return false;
+		}
+		return true;
+	};
+
+	auto createFailed = [&](Error error, const String& parameter, const String& value) {
+		ErrorArgs args;
+		args.set(ErrorArg::parameter, parameter.c_str());
+		args.set(ErrorArg::value, value.c_str());
+		return sendError(error, args);
 	};
 
 	if(segments.count() == 1) {
@@ -300,18 +710,187 @@ void Bridge::handleApiRequest(HttpServerConnection& connection)
 			return methodNotAvailable();
 		}
 
-		createUser(requestDoc.as<JsonObject>(), resultDoc, requestPath);
+		if(!pairingEnabled) {
+			return sendError(Error::LinkButtonNotPressed, ErrorArgs());
+		}
+
+		createUser(*body, resultDoc);
 		return sendResult();
 	}
 
 	const char* userName = segments[1];
-	if(!validateUser(userName)) {
+	auto user = validateUser(userName);
+	if(user == nullptr) {
 		++stats.error.unauthorizedUser;
-		createError(resultDoc, requestPath, Error::UnauthorizedUser, nullptr);
-		return sendResult();
+		return sendError(Error::UnauthorizedUser, ErrorArgs());
+	}
+
+	if(!rateLimiter.checkUser(user->rateBucket)) {
+		debug_w("[HUE] Throttled user '%s'", userName);
+		return throttled();
+	}
+
+	if(segments.count() == 2) {
+		// "/api/<username>"
+		if(request.method != HTTP_GET) {
+			return methodNotAvailable();
+		}
+		debug_i("[HUE] Get datastore");
+		if(!admission.admit(Admission::datastore, ticket)) {
+			return busy(Admission::datastore);
+		}
+		++stats.request.getDatastore;
+		return sendChunked(new DatastoreStream(*this, devices.clone()));
 	}
 
 	const char* apiName = segments[2];
+	if(F("config") == apiName) {
+		// "/api/<username>/config"
+		if(segments.count() > 3) {
+			return resourceNotAvailable();
+		}
+		if(request.method != HTTP_GET) {
+			return methodNotAvailable();
+		}
+		if(!admission.admit(Admission::config, ticket)) {
+			return busy(Admission::config);
+		}
+		++stats.request.getConfig;
+		return sendChunked(new ConfigStream(*this));
+	}
+
+	if(F("stats") == apiName) {
+		// "/api/<username>/stats": not part of Hue API
+		if(segments.count() > 3) {
+			return resourceNotAvailable();
+		}
+		if(request.method != HTTP_GET) {
+			return methodNotAvailable();
+		}
+		if(!admission.admit(Admission::stats, ticket)) {
+			return busy(Admission::stats);
+		}
+		return sendChunked(new DeviceStatsStream(deviceStats));
+	}
+
+	if(F("sensors") == apiName) {
+		// "/api/<username>/sensors/<id>"
+		if(sensors == nullptr || segments.count() > 4) {
+			return resourceNotAvailable();
+		}
+		if(request.method != HTTP_GET) {
+			return methodNotAvailable();
+		}
+		if(segments.count() == 3) {
+			if(!admission.admit(Admission::list, ticket)) {
+				return busy(Admission::list);
+			}
+			return sendChunked(new SensorListStream(sensors->clone()));
+		}
+		auto sensor = sensors->find(String(segments[3]).toInt());
+		if(sensor == nullptr) {
+			return resourceNotAvailable();
+		}
+		sensor->getInfo(resultDoc.to<JsonObject>());
+		return sendResult();
+	}
+
+	if(F("rules") == apiName) {
+		// "/api/<username>/rules/<id>"
+		if(segments.count() > 4) {
+			return resourceNotAvailable();
+		}
+		if(segments.count() == 3) {
+			if(request.method == HTTP_GET) {
+				if(!admission.admit(Admission::list, ticket)) {
+					return busy(Admission::list);
+				}
+				return sendChunked(new RuleListStream(getRules()));
+			}
+			if(request.method != HTTP_POST) {
+				return methodNotAvailable();
+			}
+			DynamicJsonDocument doc(2048);
+			if(!parseJsonBody(doc)) {
+				return;
+			}
+			unsigned ruleId;
+			Error error;
+			String parameter;
+			String value;
+			if(!getRules().create(doc.as<JsonObjectConst>(), userName, ruleId, error, parameter, value)) {
+				return createFailed(error, parameter, value);
+			}
+			createSuccess(resultDoc)[FS_id] = String(ruleId);
+			return sendResult();
+		}
+		unsigned ruleId = String(segments[3]).toInt();
+		if(request.method == HTTP_GET) {
+			auto rule = getRules().find(ruleId);
+			if(rule == nullptr) {
+				return resourceNotAvailable();
+			}
+			getRules().getInfo(*rule, resultDoc.to<JsonObject>());
+			return sendResult();
+		}
+		if(request.method != HTTP_DELETE) {
+			return methodNotAvailable();
+		}
+		if(!getRules().remove(ruleId)) {
+			return resourceNotAvailable();
+		}
+		resultDoc.to<JsonArray>().createNestedObject()[_F("success")] = requestPath + _F(" deleted");
+		return sendResult();
+	}
+
+	if(F("schedules") == apiName) {
+		// "/api/<username>/schedules/<id>"
+		if(segments.count() > 4) {
+			return resourceNotAvailable();
+		}
+		if(segments.count() == 3) {
+			if(request.method == HTTP_GET) {
+				if(!admission.admit(Admission::list, ticket)) {
+					return busy(Admission::list);
+				}
+				return sendChunked(new ScheduleListStream(getSchedules()));
+			}
+			if(request.method != HTTP_POST) {
+				return methodNotAvailable();
+			}
+			DynamicJsonDocument doc(1024);
+			if(!parseJsonBody(doc)) {
+				return;
+			}
+			unsigned scheduleId;
+			Error error;
+			String parameter;
+			String value;
+			if(!getSchedules().create(doc.as<JsonObjectConst>(), scheduleId, error, parameter, value)) {
+				return createFailed(error, parameter, value);
+			}
+			createSuccess(resultDoc)[FS_id] = String(scheduleId);
+			return sendResult();
+		}
+		unsigned scheduleId = String(segments[3]).toInt();
+		if(request.method == HTTP_GET) {
+			auto schedule = getSchedules().find(scheduleId);
+			if(schedule == nullptr) {
+				return resourceNotAvailable();
+			}
+			getSchedules().getInfo(*schedule, resultDoc.to<JsonObject>());
+			return sendResult();
+		}
+		if(request.method != HTTP_DELETE) {
+			return methodNotAvailable();
+		}
+		if(!getSchedules().remove(scheduleId)) {
+			return resourceNotAvailable();
+		}
+		resultDoc.to<JsonArray>().createNestedObject()[_F("success")] = requestPath + _F(" deleted");
+		return sendResult();
+	}
+
 	if(F("lights") != apiName) {
 		return resourceNotAvailable();
 	}
@@ -322,9 +901,12 @@ void Bridge::handleApiRequest(HttpServerConnection& connection)
 		debug_i("[HUE] Get lights (%d)", id);
 		if(id <= 0) {
 			// All devices
+			if(!admission.admit(Admission::list, ticket)) {
+				return busy(Admission::list);
+			}
 			++stats.request.getAllDeviceInfo;
-			auto stream = new DeviceListStream(devices.clone());
-			return sendStream(stream, 0);
+			encoding = requestedEncoding;
+			return sendChunked(new DeviceListStream(devices.clone(), encoding));
 		}
 
 		// Client is requesting a single device
@@ -336,10 +918,11 @@ void Bridge::handleApiRequest(HttpServerConnection& connection)
 
 		++stats.request.getDeviceInfo;
 		device->getInfo(json);
+		encoding = requestedEncoding;
 		return sendResult();
 	}
 
-	if(request.method != HTTP_POST) {
+	if(request.method != HTTP_POST && request.method != HTTP_PUT) {
 		return methodNotAvailable();
 	}
 
@@ -368,9 +951,14 @@ void Bridge::handleApiRequest(HttpServerConnection& connection)
 			return resourceNotAvailable();
 		}
 
+		if(!admission.admit(Admission::state, ticket)) {
+			return busy(Admission::state);
+		}
 		++stats.request.setDeviceInfo;
-		auto stream = new ResponseStream(*this, *device, connection, requestPath);
-		stream->handleRequest(requestDoc);
+		encoding = requestedEncoding;
+		auto stream = new ResponseStream(*this, *device, connection, requestPath, encoding);
+		stream->ticket = std::move(ticket);
+		stream->handleRequest(*body);
 		return sendStream(stream, 0);
 	}
 
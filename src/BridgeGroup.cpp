@@ -0,0 +1,102 @@
+/**
+ * BridgeGroup.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/BridgeGroup.h"
+#include <Network/UPnP/DeviceHost.h>
+#include <algorithm>
+
+namespace Hue
+{
+BridgeGroup::BridgeGroup(Device::Enumerator& devices, uint8_t count, ShardEnumerator::ShardFunction shardFunction)
+	: bridgeCount(std::min<unsigned>(count, Bridge::maxInstances))
+{
+	if(bridgeCount < count) {
+		debug_e("[HUE] Bridge count limited to %u", bridgeCount);
+	}
+	count = bridgeCount;
+	shards = new ShardEnumerator*[count];
+	bridges = new Bridge*[count];
+	for(unsigned i = 0; i < count; ++i) {
+		shards[i] = new ShardEnumerator(devices, i, count, shardFunction);
+		bridges[i] = new Bridge(*shards[i], i);
+	}
+}
+
+BridgeGroup::~BridgeGroup()
+{
+	for(unsigned i = 0; i < bridgeCount; ++i) {
+		delete bridges[i];
+		delete shards[i];
+	}
+	delete[] bridges;
+	delete[] shards;
+}
+
+void BridgeGroup::begin()
+{
+	for(unsigned i = 0; i < bridgeCount; ++i) {
+		UPnP::deviceHost.registerDevice(bridges[i]);
+		bridges[i]->begin();
+	}
+}
+
+bool BridgeGroup::onHttpRequest(HttpServerConnection& connection)
+{
+	// "/bridge<n>/..."
+	auto path = connection.getRequest()->uri.Path.c_str();
+	unsigned index = 0;
+	if(strncmp(path, "/bridge", 7) == 0) {
+		index = atoi(&path[7]);
+		if(index == 0 || index >= bridgeCount) {
+			return false;
+		}
+	}
+
+	return bridges[index]->onHttpRequest(connection);
+}
+
+void BridgeGroup::configure(const Bridge::Config& config)
+{
+	for(unsigned i = 0; i < bridgeCount; ++i) {
+		bridges[i]->configure(config);
+	}
+}
+
+void BridgeGroup::enablePairing(bool enable)
+{
+	for(unsigned i = 0; i < bridgeCount; ++i) {
+		bridges[i]->enablePairing(enable);
+	}
+}
+
+void BridgeGroup::onConfigChange(Bridge::ConfigDelegate delegate)
+{
+	for(unsigned i = 0; i < bridgeCount; ++i) {
+		bridges[i]->onConfigChange(delegate);
+	}
+}
+
+void BridgeGroup::onStateChanged(Bridge::StateChangeDelegate delegate)
+{
+	for(unsigned i = 0; i < bridgeCount; ++i) {
+		bridges[i]->onStateChanged(delegate);
+	}
+}
+
+} // namespace Hue
@@ -0,0 +1,238 @@
+/**
+ * Catalog.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/Catalog.h"
+
+namespace Hue
+{
+/* CatalogDevice */
+
+bool CatalogDevice::getAttribute(Attribute attr, unsigned& value) const
+{
+	if(state == nullptr || !caps[attr]) {
+		return false;
+	}
+
+	switch(attr) {
+	case Attribute::on:
+		value = state->on;
+		return true;
+	case Attribute::bri:
+		value = state->bri;
+		return true;
+	case Attribute::ct:
+		value = state->ct;
+		return true;
+	case Attribute::hue:
+		value = state->hue;
+		return true;
+	case Attribute::sat:
+		value = state->sat;
+		return true;
+	default:
+		return false;
+	}
+}
+
+Status CatalogDevice::setAttribute(Attribute attr, unsigned value, Callback callback)
+{
+	if(state == nullptr || !caps[attr]) {
+		return Status::error;
+	}
+
+	switch(attr) {
+	case Attribute::on:
+		state->on = (value != 0);
+		return Status::success;
+	case Attribute::bri:
+		state->bri = value;
+		return Status::success;
+	case Attribute::ct:
+		state->ct = value;
+		return Status::success;
+	case Attribute::hue:
+		state->hue = value;
+		return Status::success;
+	case Attribute::sat:
+		state->sat = value;
+		return Status::success;
+	default:
+		return Status::error;
+	}
+}
+
+Device::ColorMode CatalogDevice::getColorMode() const
+{
+	if(caps[Attribute::hue]) {
+		return ColorMode::hs;
+	}
+	if(caps[Attribute::ct]) {
+		return ColorMode::ct;
+	}
+	return ColorMode::none;
+}
+
+/* Catalog */
+
+bool Catalog::append(const String& filename, Device::ID id, Device::Attributes caps, const String& name)
+{
+	file_t file = fileOpen(filename, eFO_CreateIfNotExist | eFO_ReadWrite);
+	if(file < 0) {
+		return false;
+	}
+
+	// Entries must be in ascending ID order for lookups to work
+	Entry entry{};
+	int size = fileSeek(file, 0, eSO_FileEnd);
+	if(size >= int(sizeof(Entry))) {
+		fileSeek(file, size - sizeof(Entry), eSO_FileStart);
+		if(fileRead(file, &entry, sizeof(entry)) != int(sizeof(entry)) || entry.id >= id) {
+			debug_e("[HUE] Catalog entries must be in ascending ID order");
+			fileClose(file);
+			return false;
+		}
+	}
+
+	memset(&entry, 0, sizeof(entry));
+	entry.id = id;
+	entry.caps = caps.value();
+	strncpy(entry.name, name.c_str(), maxNameLength);
+	fileSeek(file, 0, eSO_FileEnd);
+	bool ok = fileWrite(file, &entry, sizeof(entry)) == int(sizeof(entry));
+	fileClose(file);
+	return ok;
+}
+
+bool Catalog::open(const String& filename, unsigned cacheSize)
+{
+	close();
+
+	file = fileOpen(filename, eFO_ReadOnly);
+	if(file < 0) {
+		debug_e("[HUE] Failed to open catalog '%s'", filename.c_str());
+		return false;
+	}
+
+	int size = fileSeek(file, 0, eSO_FileEnd);
+	entryCount = (size > 0) ? unsigned(size) / sizeof(Entry) : 0;
+
+	states = new CatalogDevice::State[entryCount]{};
+	views = new CatalogDevice[cacheSize];
+	if(states == nullptr || views == nullptr) {
+		close();
+		return false;
+	}
+	this->cacheSize = cacheSize;
+
+	// Defaults match those of the built-in device classes
+	for(unsigned i = 0; i < entryCount; ++i) {
+		states[i].bri = 1;
+		states[i].ct = 234;
+	}
+
+	debug_i("[HUE] Catalog '%s' has %u devices", filename.c_str(), entryCount);
+	return true;
+}
+
+void Catalog::close()
+{
+	if(file >= 0) {
+		fileClose(file);
+		file = -1;
+	}
+	delete[] views;
+	views = nullptr;
+	delete[] states;
+	states = nullptr;
+	entryCount = 0;
+	cacheSize = 0;
+}
+
+bool Catalog::readEntry(unsigned index, Entry& entry)
+{
+	if(fileSeek(file, index * sizeof(Entry), eSO_FileStart) < 0) {
+		return false;
+	}
+	return fileRead(file, &entry, sizeof(entry)) == int(sizeof(entry));
+}
+
+Device* Catalog::get(unsigned index)
+{
+	if(index >= entryCount) {
+		return nullptr;
+	}
+
+	// Already materialised?
+	CatalogDevice* view = nullptr;
+	for(unsigned i = 0; i < cacheSize; ++i) {
+		auto& v = views[i];
+		if(v.index == int(index)) {
+			v.lastUsed = ++useCount;
+			return &v;
+		}
+		if(view == nullptr || v.lastUsed < view->lastUsed) {
+			view = &v;
+		}
+	}
+
+	// Recycle least recently used view
+	Entry entry;
+	if(!readEntry(index, entry)) {
+		return nullptr;
+	}
+	entry.name[maxNameLength] = '\0';
+	view->id = entry.id;
+	view->name = entry.name;
+	view->caps = Device::Attributes(entry.caps);
+	view->state = &states[index];
+	view->index = index;
+	view->lastUsed = ++useCount;
+	return view;
+}
+
+int Catalog::indexOf(Device::ID id)
+{
+	// Check cache first
+	for(unsigned i = 0; i < cacheSize; ++i) {
+		if(views[i].index >= 0 && views[i].id == id) {
+			return views[i].index;
+		}
+	}
+
+	int lo = 0;
+	int hi = int(entryCount) - 1;
+	while(lo <= hi) {
+		int mid = (lo + hi) / 2;
+		Entry entry;
+		if(!readEntry(mid, entry)) {
+			return -1;
+		}
+		if(entry.id == id) {
+			return mid;
+		}
+		if(entry.id < id) {
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return -1;
+}
+
+} // namespace Hue
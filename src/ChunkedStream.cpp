@@ -0,0 +1,113 @@
+/**
+ * ChunkedStream.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "ChunkedStream.h"
+
+namespace Hue
+{
+void ChunkedStream::fill()
+{
+	auto startTime = micros();
+
+	started = true;
+	readPos = 0;
+	do {
+		content = nullptr;
+		if(!getContent(content)) {
+			content = nullptr;
+			finished = true;
+			break;
+		}
+	} while(content.length() == 0);
+
+	sliceTime += micros() - startTime;
+	if(finished) {
+		endSlice(false);
+	} else if(sliceBudget != 0 && sliceTime >= sliceBudget) {
+		endSlice(true);
+	}
+}
+
+void ChunkedStream::endSlice(bool yield)
+{
+	if(sliceStats != nullptr) {
+		++sliceStats->count;
+		sliceStats->totalTime += sliceTime;
+		sliceStats->maxTime = std::max(sliceStats->maxTime, sliceTime);
+		if(yield) {
+			++sliceStats->yields;
+		}
+	}
+	sliceTime = 0;
+
+	if(!yield) {
+		return;
+	}
+
+	yielding = true;
+	resumeTimer.initializeMs(1, [this]() {
+		yielding = false;
+		if(connection != nullptr) {
+			connection->send();
+		}
+	});
+	resumeTimer.startOnce();
+}
+
+uint16_t ChunkedStream::readMemoryBlock(char* data, int bufSize)
+{
+	if(bufSize <= 0) {
+		return 0;
+	}
+
+	if(yielding) {
+		return 0;
+	}
+
+	if(!started) {
+		fill();
+	}
+
+	auto len = std::min(size_t(bufSize), content.length() - readPos);
+	memcpy(data, content.c_str() + readPos, len);
+	return len;
+}
+
+bool ChunkedStream::seek(int len)
+{
+	if(len <= 0) {
+		return false;
+	}
+
+	auto newPos = readPos + len;
+	if(newPos > content.length()) {
+		debug_e("[HUE] seek(%d) out of range, max %u", len, content.length() - readPos);
+		return false;
+	}
+
+	if(newPos < content.length()) {
+		readPos = newPos;
+		return true;
+	}
+
+	fill();
+	return true;
+}
+
+} // namespace Hue
@@ -0,0 +1,100 @@
+/****
+ * ChunkedStream.h - Base class for streams whose content is generated in pieces
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <Data/Stream/DataSourceStream.h>
+#include <Network/Http/HttpServerConnection.h>
+#include <Timer.h>
+#include <WString.h>
+#include "include/Hue/Stats.h"
+#include "include/Hue/AdmissionControl.h"
+
+namespace Hue
+{
+/**
+ * @brief A forward-only stream which requests content one chunk at a time
+ *
+ * Only the current chunk is held in memory. Chunked streams may be nested by calling
+ * `getContent()` on an inner stream from the outer one.
+ *
+ * Content generation may be time-sliced: once the time spent in `getContent()` exceeds
+ * the budget, the stream stops providing data and yields to the scheduler. Sending resumes
+ * on the next task cycle.
+ */
+class ChunkedStream : public IDataSourceStream
+{
+public:
+	bool isValid() const override
+	{
+		return true;
+	}
+
+	/**
+	 * @brief Enable time-slicing
+	 * @param budget Maximum time to spend generating content before yielding, in microseconds.
+	 * 0 disables slicing.
+	 * @param stats Where to record slice metrics
+	 * @param connection Used to resume sending after yielding
+	 */
+	void setSlicing(uint32_t budget, SliceStats* stats, HttpServerConnection* connection)
+	{
+		sliceBudget = budget;
+		sliceStats = stats;
+		this->connection = connection;
+	}
+
+	uint16_t readMemoryBlock(char* data, int bufSize) override;
+
+	/**
+	 * @brief Admission held for the lifetime of this stream
+	 */
+	AdmissionControl::Ticket ticket;
+
+	bool seek(int len) override;
+
+	bool isFinished() override
+	{
+		return finished;
+	}
+
+	/**
+	 * @brief Obtain the next chunk of content
+	 * @param content Empty on entry, returns chunk
+	 * @retval bool false when there is no more content
+	 */
+	virtual bool getContent(String& content) = 0;
+
+private:
+	void fill();
+	void endSlice(bool yield);
+
+	String content;
+	Timer resumeTimer;
+	HttpServerConnection* connection{nullptr};
+	SliceStats* sliceStats{nullptr};
+	uint32_t sliceBudget{0};
+	uint32_t sliceTime{0}; ///< Time spent generating content in current slice
+	unsigned readPos{0};
+	bool started{false};
+	bool finished{false};
+	bool yielding{false};
+};
+
+} // namespace Hue
@@ -0,0 +1,79 @@
+/**
+ * ConfigStream.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "ConfigStream.h"
+#include "Strings.h"
+
+namespace Hue
+{
+bool ConfigStream::getContent(String& content)
+{
+	switch(state) {
+	case State::start: {
+		StaticJsonDocument<1024> doc;
+		bridge.getConfig(doc.to<JsonObject>());
+		content = Json::serialize(doc);
+		// Re-open object to append whitelist
+		content.setLength(content.length() - 1);
+		content += F(",\"whitelist\":{");
+		state = State::whitelist;
+		return true;
+	}
+
+	case State::whitelist: {
+		auto& users = bridge.getUsers();
+		while(userIndex < users.count()) {
+			auto& name = users.keyAt(userIndex);
+			auto& user = users.valueAt(userIndex);
+			++userIndex;
+			if(!user.authorized) {
+				continue;
+			}
+
+			// Serialize as {"name":{...}} so the key gets escaped, then strip outer braces
+			StaticJsonDocument<256> doc;
+			doc.createNestedObject(name)[FS_name] = user.deviceType;
+			content = Json::serialize(doc);
+			content.setLength(content.length() - 1);
+			if(first) {
+				content.remove(0, 1);
+			} else {
+				content[0] = ',';
+			}
+			first = false;
+			return true;
+		}
+
+		content = "}}";
+		state = State::done;
+		return true;
+	}
+
+	case State::done:
+	default:
+		return false;
+	}
+}
+
+String ConfigStream::getName() const
+{
+	return _F("config.json");
+}
+
+} // namespace Hue
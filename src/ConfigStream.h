@@ -0,0 +1,54 @@
+/****
+ * ConfigStream.h - Stream bridge configuration in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "ChunkedStream.h"
+#include "include/Hue/Bridge.h"
+
+namespace Hue
+{
+/**
+ * @brief Outputs bridge configuration followed by the whitelist, one user at a time
+ */
+class ConfigStream : public ChunkedStream
+{
+public:
+	ConfigStream(Bridge& bridge) : bridge(bridge)
+	{
+	}
+
+	bool getContent(String& content) override;
+
+	String getName() const override;
+
+private:
+	enum class State {
+		start,
+		whitelist,
+		done,
+	};
+
+	Bridge& bridge;
+	State state{State::start};
+	unsigned userIndex{0};
+	bool first{true};
+};
+
+} // namespace Hue
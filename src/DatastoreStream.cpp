@@ -0,0 +1,99 @@
+/**
+ * DatastoreStream.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "DatastoreStream.h"
+#include "DeviceListStream.h"
+#include "ConfigStream.h"
+#include "SensorListStream.h"
+#include "RuleListStream.h"
+#include "ScheduleListStream.h"
+#include <Data/CStringArray.h>
+
+namespace Hue
+{
+#define XX(tag) #tag "\0"
+DEFINE_FSTR_LOCAL(fstrSectionNames, HUE_DATASTORE_SECTION_MAP(XX));
+#undef XX
+
+ChunkedStream* DatastoreStream::createSection(Section id)
+{
+	switch(id) {
+	case Section::lights: {
+		// Stream takes ownership of enumerator
+		auto stream = new DeviceListStream(devices);
+		devices = nullptr;
+		return stream;
+	}
+	case Section::config:
+		return new ConfigStream(bridge);
+	case Section::schedules:
+		return new ScheduleListStream(bridge.getSchedules());
+	case Section::rules:
+		return new RuleListStream(bridge.getRules());
+	case Section::sensors: {
+		auto sensors = bridge.getSensors();
+		return sensors ? new SensorListStream(sensors->clone()) : nullptr;
+	}
+	default:
+		return nullptr;
+	}
+}
+
+bool DatastoreStream::getContent(String& content)
+{
+	if(sectionId == Section::MAX) {
+		return false;
+	}
+
+	if(section != nullptr) {
+		if(section->getContent(content)) {
+			return true;
+		}
+		delete section;
+		section = nullptr;
+		sectionId = Section(unsigned(sectionId) + 1);
+		if(sectionId == Section::MAX) {
+			content = '}';
+			return true;
+		}
+	}
+
+	// Start next section: ,"name":
+	content = started ? ',' : '{';
+	started = true;
+	content += '"';
+	content += CStringArray(fstrSectionNames)[unsigned(sectionId)];
+	content += "\":";
+	section = createSection(sectionId);
+	if(section == nullptr) {
+		content += "{}";
+		sectionId = Section(unsigned(sectionId) + 1);
+		if(sectionId == Section::MAX) {
+			content += '}';
+		}
+	}
+	return true;
+}
+
+String DatastoreStream::getName() const
+{
+	return _F("datastore.json");
+}
+
+} // namespace Hue
@@ -0,0 +1,77 @@
+/****
+ * DatastoreStream.h - Stream the complete bridge datastore in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "ChunkedStream.h"
+#include "include/Hue/Bridge.h"
+
+#define HUE_DATASTORE_SECTION_MAP(XX)                                                                                  \
+	XX(lights)                                                                                                         \
+	XX(groups)                                                                                                         \
+	XX(config)                                                                                                         \
+	XX(schedules)                                                                                                      \
+	XX(scenes)                                                                                                         \
+	XX(rules)                                                                                                          \
+	XX(sensors)                                                                                                        \
+	XX(resourcelinks)
+
+namespace Hue
+{
+/**
+ * @brief Outputs full bridge state as for `GET /api/<username>`
+ *
+ * Each section is generated by its own chunked stream, so the complete datastore
+ * is never held in memory. Unsupported sections are output as empty objects.
+ */
+class DatastoreStream : public ChunkedStream
+{
+public:
+	DatastoreStream(Bridge& bridge, Device::Enumerator* devices) : bridge(bridge), devices(devices)
+	{
+	}
+
+	~DatastoreStream()
+	{
+		delete section;
+		delete devices;
+	}
+
+	bool getContent(String& content) override;
+
+	String getName() const override;
+
+private:
+	enum class Section {
+#define XX(tag) tag,
+		HUE_DATASTORE_SECTION_MAP(XX)
+#undef XX
+			MAX
+	};
+
+	ChunkedStream* createSection(Section id);
+
+	Bridge& bridge;
+	Device::Enumerator* devices;
+	ChunkedStream* section{nullptr};
+	Section sectionId{Section::lights};
+	bool started{false};
+};
+
+} // namespace Hue
@@ -18,30 +18,49 @@
  ****/
 
 #include "include/Hue/Device.h"
+#include "include/Hue/Keyword.h"
 #include <Platform/Station.h>
 #include "Strings.h"
 
 namespace Hue
 {
 #define XX(t) #t "\0"
-DEFINE_FSTR_LOCAL(fstrAttrTags, HUE_DEVICE_ATTR_MAP(XX));
+DEFINE_FSTR_LOCAL(fstrColormodeTags, HUE_COLORMODE_MAP(XX));
 #undef XX
 
-#define XX(t) #t "\0"
-DEFINE_FSTR_LOCAL(fstrColormodeTags, HUE_COLORMODE_MAP(XX));
+#define XX(code, tag) #tag "\0"
+DEFINE_FSTR_LOCAL(fstrErrorArgTags, HUE_ERROR_ARG_MAP(XX));
 #undef XX
 
 String toString(Error error)
 {
+	String desc;
 	switch(error) {
-#define XX(code, tag, desc)                                                                                            \
+#define XX(code, tag, desc_)                                                                                           \
 	case Error::tag:                                                                                                   \
-		return F(desc);
+		desc = F(desc_);                                                                                               \
+		break;
 		HUE_ERROR_CODE_MAP(XX)
 #undef XX
 	default:
 		return nullptr;
 	}
+
+	// Expand argument placeholders
+	CStringArray argTags(fstrErrorArgTags);
+	String s;
+	for(unsigned i = 0; i < desc.length(); ++i) {
+		unsigned arg = desc[i];
+		if(arg != 0 && arg <= argTags.count()) {
+			s += '<';
+			s += argTags[arg - 1];
+			s += '>';
+		} else {
+			s += desc[i];
+		}
+	}
+
+	return s;
 }
 
 static JsonObject createResultObject(JsonDocument& result, const String& name)
@@ -82,20 +101,18 @@ JsonObject createError(JsonDocument& result, const String& path, Error error, St
 
 String toString(Device::Attribute attr)
 {
-	return CStringArray(fstrAttrTags)[unsigned(attr)];
+	return getKeywordName(Keyword(attr));
 }
 
 String toString(Device::Attributes attr)
 {
 	String s;
-	CStringArray csa(fstrAttrTags);
-	for(auto it = csa.begin(); it != csa.end(); it++) {
-		auto a = Device::Attribute(it.index());
-		if(attr[a]) {
+	for(unsigned i = 0; i < unsigned(Keyword::MAX) && isAttribute(Keyword(i)); ++i) {
+		if(attr[Device::Attribute(i)]) {
 			if(s) {
 				s += ',';
 			}
-			s += *it;
+			s += getKeywordName(Keyword(i));
 		}
 	}
 
@@ -104,11 +121,11 @@ String toString(Device::Attributes attr)
 
 bool fromString(const char* tag, Device::Attribute& attr)
 {
-	int i = CStringArray(fstrAttrTags).indexOf(tag);
-	if(i < 0) {
+	Keyword kw;
+	if(!fromString(tag, kw) || !isAttribute(kw)) {
 		return false;
 	}
-	attr = Device::Attribute(i);
+	attr = Device::Attribute(kw);
 	return true;
 }
 
@@ -117,38 +134,62 @@ String toString(Device::ColorMode mode)
 	return CStringArray(fstrColormodeTags)[unsigned(mode)];
 }
 
+Device::UniqueIdScheme Device::uniqueIdScheme;
+
+char* Device::formatUniqueId(ID id, char (&buffer)[uniqueIdSize])
+{
+	// MAC address doesn't change so format it just once: "AA:BB:CC:DD:EE:FF"
+	static char macString[18];
+	if(macString[0] == '\0') {
+		auto mac = WifiStation.getMacAddress();
+		char* p = macString;
+		for(unsigned i = 0; i < 6; ++i) {
+			*p++ = hexchar(mac[i] >> 4);
+			*p++ = hexchar(mac[i] & 0x0f);
+			*p++ = ':';
+		}
+		p[-1] = '\0';
+	}
+
+	unsigned idBytes;
+	if(uniqueIdScheme == UniqueIdScheme::mac40id32) {
+		// Drop first octet of MAC
+		memcpy(buffer, &macString[3], 14);
+		idBytes = 4;
+	} else {
+		memcpy(buffer, macString, 17);
+		idBytes = 3;
+	}
+
+	char* p = &buffer[uniqueIdSize - 1 - (idBytes * 3)];
+	for(unsigned i = idBytes; i > 0; --i) {
+		uint8_t c = id >> ((i - 1) * 8);
+		*p++ = (i == 1) ? '-' : ':';
+		*p++ = hexchar(c >> 4);
+		*p++ = hexchar(c & 0x0f);
+	}
+	*p = '\0';
+
+	return buffer;
+}
+
 String Device::getUniqueId() const
 {
-	String s;
-	s.reserve(26);
-	s += WifiStation.getMacAddress().toString();
-	// Append lower 24-bits of ID
-	auto id = getId();
-	s += ':';
-	s += hexchar((id >> 20) & 0x0f);
-	s += hexchar((id >> 16) & 0x0f);
-	s += ':';
-	s += hexchar((id >> 12) & 0x0f);
-	s += hexchar((id >> 8) & 0x0f);
-	s += '-';
-	s += hexchar((id >> 4) & 0x0f);
-	s += hexchar(id & 0x0f);
-	return s;
+	char buffer[uniqueIdSize];
+	return formatUniqueId(getId(), buffer);
 }
 
 void Device::getInfo(JsonObject json)
 {
 	bool isColour = false;
 
-	CStringArray attrTags(fstrAttrTags);
-
 	auto getAttr = [&](JsonObject obj, Device::Attribute attr) {
 		unsigned value = 0;
 		if(!getAttribute(attr, value)) {
 			return;
 		}
 
-		String tag = attrTags[unsigned(attr)];
+		auto tag = getKeywordName(Keyword(attr));
 		if(attr == Attribute::on) {
 			obj[tag] = (value != 0);
 		} else {
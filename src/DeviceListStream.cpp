@@ -21,103 +21,54 @@
 
 namespace Hue
 {
-bool DeviceListStream::getContent()
+bool DeviceListStream::getContent(String& content)
 {
-	if(state == 0) {
-		devices->reset();
-		content = nullptr;
-	} else {
-		content = ',';
-	}
-
-	auto device = devices->next();
-	if(device == nullptr) {
-		return false;
-	}
-
-	StaticJsonDocument<2048> doc;
-	device->getInfo(doc.to<JsonObject>());
-	content += '"';
-	content += device->getId();
-	content += "\":";
-	content += Json::serialize(doc);
-	return true;
-}
-
-uint16_t DeviceListStream::readMemoryBlock(char* data, int bufSize)
-{
-	if(bufSize <= 0) {
-		return 0;
-	}
-
 	switch(state) {
-	case 0: {
-		*data = '{';
-		return 1;
-	}
-
-	case 1: {
-		auto len = std::min(size_t(bufSize), content.length() - readPos);
-		memcpy(data, &content[readPos], len);
-		return len;
-	}
-
-	case 2: {
-		*data = '}';
-		return 1;
-	}
-
-	default:
-		return 0;
-	}
-}
-
-bool DeviceListStream::seek(int len)
-{
-	if(len <= 0) {
-		return false;
-	}
-
-	switch(state) {
-	case 0:
-		if(len != 1) {
-			return false;
-		}
-		if(getContent()) {
-			state = 1;
+	case State::start:
+		devices->reset();
+		if(encoding == Encoding::msgpack) {
+			unsigned count{0};
+			while(devices->next() != nullptr) {
+				++count;
+			}
+			devices->reset();
+			writeMsgPackMap(content, count);
 		} else {
-			// No devices, finish now
-			state = 2;
+			content = '{';
 		}
+		state = State::devices;
 		return true;
 
-	case 1: {
-		auto newPos = readPos + len;
-		if(newPos > content.length()) {
-			debug_e("[HUE] seek(%d) out of range, max %u", len, content.length());
-			return false;
-		}
-		if(newPos < content.length()) {
-			readPos = newPos;
+	case State::devices: {
+		auto device = devices->next();
+		if(device == nullptr) {
+			state = State::done;
+			if(encoding == Encoding::msgpack) {
+				return false;
+			}
+			content = '}';
 			return true;
 		}
 
-		content = nullptr;
-		readPos = 0;
-
-		if(!getContent()) {
-			++state;
+		StaticJsonDocument<2048> doc;
+		device->getInfo(doc.to<JsonObject>());
+		if(encoding == Encoding::msgpack) {
+			writeMsgPackString(content, String(device->getId()));
+			serialize(doc, content, encoding);
+			return true;
 		}
-		return true;
-	}
-
-	case 2:
-		if(len != 1) {
-			return false;
+		if(!first) {
+			content = ',';
 		}
-		++state;
+		first = false;
+		content += '"';
+		content += device->getId();
+		content += "\":";
+		content += Json::serialize(doc);
 		return true;
+	}
 
+	case State::done:
 	default:
 		return false;
 	}
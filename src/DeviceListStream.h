@@ -19,19 +19,23 @@
 
 #pragma once
 
-#include <Data/Stream/DataSourceStream.h>
+#include "ChunkedStream.h"
 #include "include/Hue/Device.h"
+#include "Encoding.h"
 
 namespace Hue
 {
 /**
- * @brief A forward-only stream for listing contents of a tune file
- * @note Tune files can be large so we only output one tune title at a time
+ * @brief A forward-only stream for listing device information
+ * @note Device lists can be large so we only output one device at a time
+ *
+ * For MessagePack, devices are counted first as the map size must precede its content.
  */
-class DeviceListStream : public IDataSourceStream
+class DeviceListStream : public ChunkedStream
 {
 public:
-	DeviceListStream(Device::Enumerator* devices) : devices(devices)
+	DeviceListStream(Device::Enumerator* devices, Encoding encoding = Encoding::json)
+		: devices(devices), encoding(encoding)
 	{
 	}
 
@@ -40,31 +44,21 @@ public:
 		delete devices;
 	}
 
-	bool isValid() const override
-	{
-		return true;
-	}
-
-	uint16_t readMemoryBlock(char* data, int bufSize) override;
-
-	bool seek(int len) override;
-
-	bool isFinished() override
-	{
-		return state >= 3;
-	}
+	bool getContent(String& content) override;
 
 	String getName() const override;
 
-protected:
-	bool getContent();
-	void begin();
-
 private:
+	enum class State {
+		start,
+		devices,
+		done,
+	};
+
 	Device::Enumerator* devices;
-	String content;
-	uint8_t state = 0;
-	unsigned readPos = 0;
+	Encoding encoding;
+	State state{State::start};
+	bool first{true};
 };
 
 } // namespace Hue
@@ -0,0 +1,202 @@
+/**
+ * DeviceStats.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/DeviceStats.h"
+#include "Strings.h"
+#include <algorithm>
+
+namespace Hue
+{
+unsigned DeviceStats::Entry::percentile(unsigned percent) const
+{
+	unsigned total{0};
+	for(auto n : histogram) {
+		total += n;
+	}
+	if(total == 0) {
+		return 0;
+	}
+
+	unsigned threshold = (total * percent + 99) / 100;
+	unsigned count{0};
+	for(unsigned i = 0; i < bucketCount; ++i) {
+		count += histogram[i];
+		if(count >= threshold) {
+			return (i + 1 < bucketCount) ? (firstBucketLimit << i) : maxResponseTime;
+		}
+	}
+	return maxResponseTime;
+}
+
+bool DeviceStats::rebuild()
+{
+	// Use a private enumerator so we don't disturb any iteration in progress
+	std::unique_ptr<Device::Enumerator> list(devices.clone());
+	if(!list) {
+		return false;
+	}
+
+	unsigned count{0};
+	while(list->next() != nullptr) {
+		++count;
+	}
+
+	std::unique_ptr<Entry[]> table(new Entry[count]);
+	if(!table) {
+		return false;
+	}
+
+	// Carry over existing statistics
+	list->reset();
+	for(unsigned i = 0; i < count; ++i) {
+		auto device = list->next();
+		if(device == nullptr) {
+			count = i;
+			break;
+		}
+		auto& entry = table[i];
+		auto existing = find(device->getId());
+		if(existing == nullptr) {
+			memset(&entry, 0, sizeof(entry));
+			entry.id = device->getId();
+		} else {
+			entry = *existing;
+		}
+	}
+
+	std::sort(table.get(), table.get() + count, [](const Entry& a, const Entry& b) { return a.id < b.id; });
+	entries = std::move(table);
+	size = count;
+	debug_d("[HUE] Device stats table holds %u devices", size);
+	return true;
+}
+
+DeviceStats::Entry* DeviceStats::get(Device::ID id)
+{
+	auto entry = const_cast<Entry*>(find(id));
+	if(entry == nullptr && rebuild()) {
+		entry = const_cast<Entry*>(find(id));
+	}
+	return entry;
+}
+
+const DeviceStats::Entry* DeviceStats::find(Device::ID id) const
+{
+	auto end = entries.get() + size;
+	auto entry = std::lower_bound(entries.get(), end, id, [](const Entry& e, Device::ID id) { return e.id < id; });
+	return (entry != end && entry->id == id) ? entry : nullptr;
+}
+
+void DeviceStats::record(Device::ID id, Status status, uint32_t latency, uint32_t responseTime)
+{
+	auto entry = get(id);
+	if(entry == nullptr) {
+		return;
+	}
+	++entry->commands;
+	if(status != Status::success) {
+		++entry->failures;
+	}
+
+	unsigned bucket{0};
+	while(bucket + 1 < bucketCount && responseTime >= (firstBucketLimit << bucket)) {
+		++bucket;
+	}
+	if(entry->histogram[bucket] == 0xff) {
+		for(auto& n : entry->histogram) {
+			n /= 2;
+		}
+	}
+	++entry->histogram[bucket];
+	entry->totalLatency += latency;
+	entry->maxLatency = std::max(entry->maxLatency, uint16_t(std::min(latency, 0xffffU)));
+	entry->maxResponseTime = std::max(entry->maxResponseTime, uint16_t(std::min(responseTime, 0xffffU)));
+}
+
+void DeviceStats::timeout(Device::ID id)
+{
+	auto entry = get(id);
+	if(entry == nullptr) {
+		return;
+	}
+	++entry->commands;
+	++entry->timeouts;
+}
+
+void DeviceStats::serialize(const Entry& entry, JsonObject json) const
+{
+	json[FS_count] = entry.commands;
+	json[FS_failed] = entry.failures;
+	json[FS_timeouts] = entry.timeouts;
+	unsigned completed = entry.commands - entry.timeouts;
+	json[FS_avg] = (completed == 0) ? 0 : entry.totalLatency / completed;
+	json[FS_max] = entry.maxLatency;
+	json[FS_p50] = entry.percentile(50);
+	json[FS_p95] = entry.percentile(95);
+	auto hist = json.createNestedArray(FS_hist);
+	for(auto n : entry.histogram) {
+		hist.add(n);
+	}
+}
+
+void DeviceStats::serializeSummary(JsonObject json) const
+{
+	unsigned commands{0};
+	unsigned failures{0};
+	unsigned timeouts{0};
+	const Entry* worst[summaryDevices]{};
+	auto errors = [](const Entry& e) { return e.failures + e.timeouts; };
+
+	for(unsigned i = 0; i < size; ++i) {
+		auto& entry = entries[i];
+		commands += entry.commands;
+		failures += entry.failures;
+		timeouts += entry.timeouts;
+		if(errors(entry) == 0) {
+			continue;
+		}
+		// Keep list ordered, most errors first
+		for(unsigned j = 0; j < summaryDevices; ++j) {
+			if(worst[j] == nullptr || errors(entry) > errors(*worst[j])) {
+				std::copy_backward(&worst[j], &worst[summaryDevices - 1], &worst[summaryDevices]);
+				worst[j] = &entry;
+				break;
+			}
+		}
+	}
+
+	auto jdev = json.createNestedObject(FS_devices);
+	jdev[FS_count] = commands;
+	jdev[FS_failed] = failures;
+	jdev[FS_timeouts] = timeouts;
+	auto jworst = jdev.createNestedArray(FS_worst);
+	for(auto entry : worst) {
+		if(entry == nullptr) {
+			break;
+		}
+		auto obj = jworst.createNestedObject();
+		obj[FS_id] = entry->id;
+		obj[FS_count] = entry->commands;
+		obj[FS_failed] = entry->failures;
+		obj[FS_timeouts] = entry->timeouts;
+		obj[FS_p95] = entry->percentile(95);
+	}
+}
+
+} // namespace Hue
@@ -0,0 +1,65 @@
+/**
+ * DeviceStatsStream.cpp - Stream per-device statistics in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "DeviceStatsStream.h"
+
+namespace Hue
+{
+bool DeviceStatsStream::getContent(String& content)
+{
+	if(done) {
+		return false;
+	}
+
+	if(!started) {
+		content = '{';
+		started = true;
+		return true;
+	}
+
+	// Skip unused entries
+	const DeviceStats::Entry* entry;
+	do {
+		if(index >= stats.getSize()) {
+			content = '}';
+			done = true;
+			return true;
+		}
+		entry = stats.getEntry(index++);
+	} while(entry == nullptr);
+
+	StaticJsonDocument<512> doc;
+	stats.serialize(*entry, doc.to<JsonObject>());
+	if(!first) {
+		content = ',';
+	}
+	first = false;
+	content += '"';
+	content += entry->id;
+	content += "\":";
+	content += Json::serialize(doc);
+	return true;
+}
+
+String DeviceStatsStream::getName() const
+{
+	return _F("devicestats.json");
+}
+
+} // namespace Hue
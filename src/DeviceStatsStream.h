@@ -0,0 +1,49 @@
+/****
+ * DeviceStatsStream.h - Stream per-device statistics in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "ChunkedStream.h"
+#include "include/Hue/DeviceStats.h"
+
+namespace Hue
+{
+/**
+ * @brief Stream statistics for all devices, one device per chunk
+ */
+class DeviceStatsStream : public ChunkedStream
+{
+public:
+	DeviceStatsStream(const DeviceStats& stats) : stats(stats)
+	{
+	}
+
+	bool getContent(String& content) override;
+
+	String getName() const override;
+
+private:
+	const DeviceStats& stats;
+	unsigned index{0};
+	bool started{false};
+	bool first{true};
+	bool done{false};
+};
+
+} // namespace Hue
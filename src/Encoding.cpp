@@ -0,0 +1,141 @@
+/**
+ * Encoding.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "Encoding.h"
+#include <Data/WebConstants.h>
+#include <algorithm>
+
+namespace Hue
+{
+DEFINE_FSTR_LOCAL(fstrMsgPackType, "application/msgpack")
+
+namespace
+{
+/*
+ * Parse a quality value such as "0.8", giving a result from 0 to 1000
+ */
+unsigned parseQuality(const char* s)
+{
+	if(s[0] != '0') {
+		return 1000;
+	}
+	unsigned quality{0};
+	if(s[1] == '.') {
+		unsigned scale{100};
+		for(auto p = &s[2]; scale != 0 && isdigit(*p); ++p, scale /= 10) {
+			quality += (*p - '0') * scale;
+		}
+	}
+	return quality;
+}
+
+} // namespace
+
+Encoding getEncoding(const HttpRequest& request)
+{
+	auto accept = request.headers[HTTP_HEADER_ACCEPT];
+	unsigned jsonQuality{0};
+	unsigned msgPackQuality{0};
+
+	// Each media range is "type/subtype" followed by optional parameters, e.g. "application/json;q=0.5"
+	auto s = accept.c_str();
+	while(*s != '\0') {
+		while(*s == ' ' || *s == ',') {
+			++s;
+		}
+		auto type = s;
+		while(*s != '\0' && *s != ';' && *s != ',' && *s != ' ') {
+			++s;
+		}
+		size_t typeLength = s - type;
+
+		unsigned quality{1000};
+		while(*s != '\0' && *s != ',') {
+			if(*s++ != ';') {
+				continue;
+			}
+			while(*s == ' ') {
+				++s;
+			}
+			if((s[0] == 'q' || s[0] == 'Q') && s[1] == '=') {
+				quality = parseQuality(&s[2]);
+			}
+		}
+
+		auto matches = [&](const char* name) {
+			return typeLength == strlen(name) && strncasecmp(type, name, typeLength) == 0;
+		};
+		if(matches(_F("application/msgpack")) || matches(_F("application/x-msgpack"))) {
+			msgPackQuality = std::max(msgPackQuality, quality);
+		} else if(matches(_F("application/json")) || matches(_F("application/*")) || matches(_F("*/*"))) {
+			jsonQuality = std::max(jsonQuality, quality);
+		}
+	}
+
+	return (msgPackQuality != 0 && msgPackQuality >= jsonQuality) ? Encoding::msgpack : Encoding::json;
+}
+
+String getContentType(Encoding encoding)
+{
+	return (encoding == Encoding::msgpack) ? String(fstrMsgPackType) : ::toString(MIME_JSON);
+}
+
+size_t serialize(const JsonDocument& doc, Print& out, Encoding encoding)
+{
+	return (encoding == Encoding::msgpack) ? serializeMsgPack(doc, out) : serializeJson(doc, out);
+}
+
+size_t serialize(const JsonDocument& doc, String& content, Encoding encoding)
+{
+	auto len = (encoding == Encoding::msgpack) ? measureMsgPack(doc) : measureJson(doc);
+	auto pos = content.length();
+	if(!content.setLength(pos + len)) {
+		return 0;
+	}
+	// Serializers append a NUL if there's room, but String has already reserved space for one
+	auto buf = content.begin() + pos;
+	return (encoding == Encoding::msgpack) ? serializeMsgPack(doc, buf, len + 1) : serializeJson(doc, buf, len + 1);
+}
+
+void writeMsgPackMap(String& content, uint32_t count)
+{
+	if(count < 16) {
+		content += char(0x80 | count);
+		return;
+	}
+	// map32
+	char buf[]{char(0xdf), char(count >> 24), char(count >> 16), char(count >> 8), char(count)};
+	content.concat(buf, sizeof(buf));
+}
+
+void writeMsgPackString(String& content, const String& value)
+{
+	auto len = value.length();
+	if(len < 32) {
+		content += char(0xa0 | len);
+	} else {
+		// str8: keys are short
+		char buf[]{char(0xd9), char(std::min(len, size_t(255)))};
+		content.concat(buf, sizeof(buf));
+		len = uint8_t(buf[1]);
+	}
+	content.concat(value.c_str(), len);
+}
+
+} // namespace Hue
@@ -0,0 +1,76 @@
+/****
+ * Encoding.h - Negotiated response encodings
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <Network/Http/HttpRequest.h>
+#include <ArduinoJson6.h>
+#include <Print.h>
+#include <WString.h>
+
+namespace Hue
+{
+/**
+ * @brief Response body encodings
+ *
+ * Clients may request MessagePack by including `application/msgpack` (or `application/x-msgpack`)
+ * in the `Accept` header. It is used unless JSON is given a higher quality value, and `q=0` excludes it.
+ * The data model is identical to JSON.
+ */
+enum class Encoding {
+	json,
+	msgpack,
+};
+
+/**
+ * @brief Determine which encoding a client has asked for
+ */
+Encoding getEncoding(const HttpRequest& request);
+
+/**
+ * @brief Get the Content-Type for an encoding
+ */
+String getContentType(Encoding encoding);
+
+/**
+ * @brief Serialize a document
+ * @retval size_t Number of bytes written
+ */
+size_t serialize(const JsonDocument& doc, Print& out, Encoding encoding);
+
+/**
+ * @brief Serialize a document, appending to content
+ * @retval size_t Number of bytes written
+ * @note MessagePack content is binary and may contain NUL characters
+ */
+size_t serialize(const JsonDocument& doc, String& content, Encoding encoding);
+
+/**
+ * @brief Append a MessagePack map header
+ * @param content
+ * @param count Number of key/value pairs which follow
+ */
+void writeMsgPackMap(String& content, uint32_t count);
+
+/**
+ * @brief Append a MessagePack string
+ */
+void writeMsgPackString(String& content, const String& value);
+
+} // namespace Hue
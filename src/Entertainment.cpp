@@ -0,0 +1,224 @@
+/**
+ * Entertainment.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/Entertainment.h"
+#include "include/Hue/Bridge.h"
+#include <Platform/Timers.h>
+#include <algorithm>
+
+namespace Hue
+{
+namespace
+{
+constexpr char protocolName[]{'H', 'u', 'e', 'S', 't', 'r', 'e', 'a', 'm'};
+constexpr unsigned headerSize{16};
+constexpr unsigned lightSize{9};
+
+uint16_t getWord(const uint8_t* p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+} // namespace
+
+Entertainment::Light Entertainment::Frame::getLight(unsigned index) const
+{
+	auto p = &data[index * lightSize];
+	return Light{getWord(&p[1]), {getWord(&p[3]), getWord(&p[5]), getWord(&p[7])}};
+}
+
+void Entertainment::receive(UdpConnection&, char* data, int size, IpAddress remoteIP, uint16_t)
+{
+	auto buf = reinterpret_cast<const uint8_t*>(data);
+	if(size < int(headerSize) || memcmp(buf, protocolName, sizeof(protocolName)) != 0 || buf[9] != 0x01 ||
+	   (size - headerSize) % lightSize != 0 || buf[14] > uint8_t(ColourSpace::xy)) {
+		++stats.invalid;
+		return;
+	}
+
+	auto now = millis();
+	if(streaming && now - lastFrameTime >= config.idleTimeout) {
+		debug_i("[HUE] Entertainment stream from %s ended", source.toString().c_str());
+		streaming = false;
+		busyCount = 0;
+	}
+
+	uint8_t sequence = buf[11];
+	if(streaming) {
+		if(remoteIP != source) {
+			++stats.ignored;
+			return;
+		}
+		// Sequence number wraps, so compare modulo 256
+		if(int8_t(sequence - lastSequence) <= 0) {
+			++stats.stale;
+			return;
+		}
+	} else {
+		debug_i("[HUE] Entertainment stream from %s started", remoteIP.toString().c_str());
+		source = remoteIP;
+		streaming = true;
+	}
+	lastSequence = sequence;
+	lastFrameTime = now;
+
+	Frame frame{sequence, ColourSpace(buf[14]), uint16_t((size - headerSize) / lightSize), &buf[headerSize]};
+	++stats.frames;
+	stats.lights += frame.lightCount;
+	if(frameDelegate) {
+		frameDelegate(frame);
+	} else {
+		apply(frame);
+	}
+}
+
+bool Entertainment::isBusy(Device::ID id) const
+{
+	for(unsigned i = 0; i < busyCount; ++i) {
+		if(busy[i].id == id) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void Entertainment::setBusy(Device::ID id, bool state)
+{
+	if(state) {
+		auto timeout = bridge.getRetryPolicy().getTimeout(bridge.getDeviceStats().find(id));
+		busy[busyCount++] = Busy{id, millis() + timeout};
+		return;
+	}
+	for(unsigned i = 0; i < busyCount; ++i) {
+		if(busy[i].id == id) {
+			busy[i] = busy[--busyCount];
+			return;
+		}
+	}
+}
+
+void Entertainment::expireBusy()
+{
+	auto now = millis();
+	for(unsigned i = 0; i < busyCount;) {
+		if(int32_t(now - busy[i].deadline) >= 0) {
+			debug_w("[HUE] Entertainment gave up waiting for device #%u", busy[i].id);
+			busy[i] = busy[--busyCount];
+		} else {
+			++i;
+		}
+	}
+}
+
+void Entertainment::apply(const Frame& frame)
+{
+	using Attr = Device::Attribute;
+
+	expireBusy();
+
+	auto& devices = bridge.getDevices();
+	for(unsigned i = 0; i < frame.lightCount; ++i) {
+		if(frame.data[i * lightSize] != 0) {
+			// Not a light
+			continue;
+		}
+		auto light = frame.getLight(i);
+		auto device = devices.find(light.id);
+		if(device == nullptr) {
+			continue;
+		}
+		if(isBusy(light.id)) {
+			++stats.busy;
+			continue;
+		}
+
+		Device::Attributes changed;
+		bool pended{false};
+		auto set = [&](Attr attr, unsigned value) {
+			unsigned current;
+			if(pended || (device->getAttribute(attr, current) && current == value)) {
+				return;
+			}
+			if(busyCount == ARRAY_SIZE(busy)) {
+				// Device might not complete immediately, and couldn't then be tracked
+				++stats.busy;
+				pended = true;
+				return;
+			}
+			auto id = light.id;
+			auto result = device->setAttribute(attr, value, [this, id, attr](Status status, int) {
+				setBusy(id, false);
+				auto dev = bridge.getDevices().find(id);
+				if(status == Status::success && dev != nullptr) {
+					Device::Attributes attrs;
+					attrs[attr] = true;
+					bridge.deviceStateChanged(*dev, attrs);
+				}
+			});
+			if(result == Status::success) {
+				changed[attr] = true;
+			} else if(result == Status::pending) {
+				setBusy(id, true);
+				pended = true;
+			}
+		};
+
+		if(frame.colourSpace == ColourSpace::xy) {
+			// Only brightness is applied: xy mapping depends on the lamp gamut
+			auto bri = light.values[2] / 258;
+			set(Attr::on, bri != 0);
+			if(bri != 0) {
+				set(Attr::bri, bri);
+			}
+		} else {
+			// RGB to HSV, hue 0-65535, saturation and brightness 0-254
+			auto& v = light.values;
+			unsigned max = std::max(v[0], std::max(v[1], v[2]));
+			unsigned min = std::min(v[0], std::min(v[1], v[2]));
+			unsigned bri = max / 258;
+			set(Attr::on, bri != 0);
+			if(bri != 0) {
+				set(Attr::bri, bri);
+				unsigned delta = max - min;
+				set(Attr::sat, delta * 254 / max);
+				if(delta != 0) {
+					// Each sixth of the colour wheel spans 65536 / 6
+					auto sector = [&](int a, int b, int offset) {
+						return offset + int(int64_t(a - b) * 65536 / (6 * int(delta)));
+					};
+					int h;
+					if(max == v[0]) {
+						h = sector(v[1], v[2], 0);
+					} else if(max == v[1]) {
+						h = sector(v[2], v[0], 65536 / 3);
+					} else {
+						h = sector(v[0], v[1], 65536 * 2 / 3);
+					}
+					set(Attr::hue, unsigned(h) & 0xffff);
+				}
+			}
+		}
+
+		if(changed.any()) {
+			bridge.deviceStateChanged(*device, changed);
+		}
+	}
+}
+
+} // namespace Hue
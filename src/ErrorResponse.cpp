@@ -0,0 +1,132 @@
+/**
+ * ErrorResponse.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "ErrorResponse.h"
+
+namespace Hue
+{
+namespace
+{
+#define XX(code, tag, desc) DEFINE_FSTR_LOCAL(fstrError_##tag, desc)
+HUE_ERROR_CODE_MAP(XX)
+#undef XX
+
+const FlashString* getTemplate(Error error)
+{
+	switch(error) {
+#define XX(code, tag, desc)                                                                                            \
+	case Error::tag:                                                                                                   \
+		return &fstrError_##tag;
+		HUE_ERROR_CODE_MAP(XX)
+#undef XX
+	default:
+		return nullptr;
+	}
+}
+
+} // namespace
+
+size_t writeJsonChars(Print& out, const char* value)
+{
+	if(value == nullptr) {
+		return 0;
+	}
+
+	size_t n = 0;
+	const char* run = value;
+	for(; *value != '\0'; ++value) {
+		char c = *value;
+		if(c != '"' && c != '\\' && uint8_t(c) >= 0x20) {
+			continue;
+		}
+		n += out.write(run, value - run);
+		run = value + 1;
+		char buf[7];
+		if(c == '"' || c == '\\') {
+			buf[0] = '\\';
+			buf[1] = c;
+			buf[2] = '\0';
+		} else {
+			m_snprintf(buf, sizeof(buf), "\\u%04x", c);
+		}
+		n += out.print(buf);
+	}
+	n += out.write(run, value - run);
+	return n;
+}
+
+size_t writeJsonString(Print& out, const char* value)
+{
+	size_t n = out.print('"');
+	n += writeJsonChars(out, value);
+	n += out.print('"');
+	return n;
+}
+
+size_t writeError(Print& out, Error error, const char* address, const ErrorArgs& args)
+{
+	size_t n = out.print(_F("{\"error\":{\"type\":"));
+	n += out.print(unsigned(error));
+	n += out.print(_F(",\"address\":"));
+	n += writeJsonString(out, address);
+	n += out.print(_F(",\"description\":\""));
+
+	auto tmpl = getTemplate(error);
+	if(tmpl != nullptr) {
+		// Write runs of text between placeholders
+		LOAD_FSTR(desc, *tmpl);
+		const char* run = desc;
+		const char* p = desc;
+		for(; *p != '\0'; ++p) {
+			if(uint8_t(*p) > ErrorArgs::count) {
+				continue;
+			}
+			n += out.write(run, p - run);
+			run = p + 1;
+			n += writeJsonChars(out, args.get(ErrorArg(*p)));
+		}
+		n += out.write(run, p - run);
+	}
+
+	n += out.print(_F("\"}}"));
+
+	debug_i("[HUE] ERROR %u: %s", unsigned(error), address);
+
+	return n;
+}
+
+String getErrorDescription(Error error, const ErrorArgs& args)
+{
+	String s;
+	auto tmpl = getTemplate(error);
+	if(tmpl == nullptr) {
+		return s;
+	}
+	LOAD_FSTR(desc, *tmpl);
+	for(const char* p = desc; *p != '\0'; ++p) {
+		if(uint8_t(*p) > ErrorArgs::count) {
+			s += *p;
+		} else {
+			s += args.get(ErrorArg(*p));
+		}
+	}
+	return s;
+}
+
+} // namespace Hue
@@ -0,0 +1,93 @@
+/****
+ * ErrorResponse.h - Write Hue error responses directly to a stream
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "include/Hue/Device.h"
+#include <Print.h>
+
+namespace Hue
+{
+/**
+ * @brief Values to substitute for placeholders in error descriptions
+ */
+class ErrorArgs
+{
+public:
+	static constexpr unsigned count{0
+#define XX(code, tag) +1
+									HUE_ERROR_ARG_MAP(XX)
+#undef XX
+	};
+
+	ErrorArgs& set(ErrorArg arg, const char* value)
+	{
+		values[unsigned(arg) - 1] = value;
+		return *this;
+	}
+
+	const char* get(ErrorArg arg) const
+	{
+		return values[unsigned(arg) - 1];
+	}
+
+private:
+	const char* values[count]{};
+};
+
+/**
+ * @brief Write JSON-escaped string content, without quotes
+ * @retval size_t Number of characters written
+ */
+size_t writeJsonChars(Print& out, const char* value);
+
+/**
+ * @brief Write a JSON-escaped, quoted string
+ * @retval size_t Number of characters written
+ */
+size_t writeJsonString(Print& out, const char* value);
+
+/**
+ * @brief Write a single error object, `{"error":{...}}`
+ * @param out
+ * @param error
+ * @param address Resource path
+ * @param args Values for placeholders in the description
+ * @retval size_t Number of characters written
+ */
+size_t writeError(Print& out, Error error, const char* address, const ErrorArgs& args = ErrorArgs());
+
+/**
+ * @brief Get error description with placeholders replaced, for use with a `JsonDocument`
+ */
+String getErrorDescription(Error error, const ErrorArgs& args = ErrorArgs());
+
+/**
+ * @brief Write a complete error response, `[{"error":{...}}]`
+ * @retval size_t Number of characters written
+ */
+inline size_t writeErrorResponse(Print& out, Error error, const char* address, const ErrorArgs& args = ErrorArgs())
+{
+	size_t n = out.print('[');
+	n += writeError(out, error, address, args);
+	n += out.print(']');
+	return n;
+}
+
+} // namespace Hue
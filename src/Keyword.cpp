@@ -0,0 +1,69 @@
+/**
+ * Keyword.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/Keyword.h"
+
+namespace Hue
+{
+namespace
+{
+// Kept in RAM so comparisons don't need aligned flash reads
+const char* const keywordNames[] = {
+#define XX(t) #t,
+	HUE_KEYWORD_MAP(XX)
+#undef XX
+};
+
+static_assert(ARRAY_SIZE(keywordNames) == unsigned(Keyword::MAX), "Keyword table mismatch");
+
+} // namespace
+
+const char* getKeywordName(Keyword kw)
+{
+	return (kw < Keyword::MAX) ? keywordNames[unsigned(kw)] : nullptr;
+}
+
+bool fromString(const char* tag, Keyword& kw)
+{
+	auto len = strlen(tag);
+	if(len == 0) {
+		return false;
+	}
+
+	Keyword match;
+	switch(keywordHash(tag, len)) {
+#define XX(t)                                                                                                          \
+	case keywordHash(#t, sizeof(#t) - 1):                                                                              \
+		match = Keyword::t;                                                                                            \
+		break;
+		HUE_KEYWORD_MAP(XX)
+#undef XX
+	default:
+		return false;
+	}
+
+	if(strcmp(tag, keywordNames[unsigned(match)]) != 0) {
+		return false;
+	}
+
+	kw = match;
+	return true;
+}
+
+} // namespace Hue
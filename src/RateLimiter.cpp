@@ -0,0 +1,94 @@
+/**
+ * RateLimiter.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/RateLimiter.h"
+#include <Platform/Timers.h>
+
+namespace Hue
+{
+bool TokenBucket::take(uint32_t now, uint8_t rate, uint8_t burst)
+{
+	uint32_t limit = burst * 1000U;
+	if(timestamp == 0) {
+		tokens = limit;
+	} else {
+		// Limit elapsed time to avoid overflow; a minute is enough to fill any bucket
+		uint32_t elapsed = std::min(now - timestamp, 60000U);
+		tokens = std::min(limit, tokens + elapsed * rate);
+	}
+	timestamp = now ?: 1;
+	if(tokens < 1000) {
+		return false;
+	}
+	tokens -= 1000;
+	return true;
+}
+
+bool TokenBucket::isFull(uint32_t now, uint8_t rate, uint8_t burst) const
+{
+	if(timestamp == 0) {
+		return true;
+	}
+	uint32_t limit = burst * 1000U;
+	uint32_t elapsed = std::min(now - timestamp, 60000U);
+	return tokens + elapsed * rate >= limit;
+}
+
+bool RateLimiter::checkAddress(IpAddress address)
+{
+	if(config.addressRate == 0) {
+		return true;
+	}
+
+	auto now = millis();
+
+	// Find entry for this address, or one whose bucket has refilled
+	Entry* entry = nullptr;
+	Entry* spare = nullptr;
+	for(auto& e : entries) {
+		if(e.address == address) {
+			entry = &e;
+			break;
+		}
+		if(spare == nullptr && e.bucket.isFull(now, config.addressRate, config.addressBurst)) {
+			spare = &e;
+		}
+	}
+	if(entry == nullptr) {
+		if(spare == nullptr) {
+			// Every tracked address is still active
+			return false;
+		}
+		entry = spare;
+		entry->address = address;
+		entry->bucket = TokenBucket{};
+	}
+
+	return entry->bucket.take(now, config.addressRate, config.addressBurst);
+}
+
+bool RateLimiter::checkUser(TokenBucket& bucket)
+{
+	if(config.userRate == 0) {
+		return true;
+	}
+	return bucket.take(millis(), config.userRate, config.userBurst);
+}
+
+} // namespace Hue
@@ -0,0 +1,411 @@
+/**
+ * RequestBody.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/RequestBody.h"
+#include <Network/Http/HttpBodyParser.h>
+
+namespace Hue
+{
+namespace
+{
+class SlotStream;
+
+/*
+ * Parsing state is held in a small static pool so there's no heap allocation.
+ * If no slot is free the body is buffered instead.
+ */
+struct Slot {
+	SlotStream* stream; ///< Owner, nullptr if slot is free
+	RequestBody body;
+};
+
+Slot slots[HUE_BODY_PARSER_SLOTS];
+
+/*
+ * A slot in use is owned by an empty stream attached to the request as its body.
+ * The request deletes its body when it completes, is reset or the connection closes,
+ * so the slot can't outlive the request.
+ */
+class SlotStream : public IDataSourceStream
+{
+public:
+	SlotStream(Slot& slot) : slot(slot)
+	{
+		slot.stream = this;
+	}
+
+	~SlotStream()
+	{
+		slot.stream = nullptr;
+	}
+
+	bool isValid() const override
+	{
+		return true;
+	}
+
+	// Content has already been consumed by the parser
+	int available() override
+	{
+		return 0;
+	}
+
+	uint16_t readMemoryBlock(char* data, int bufSize) override
+	{
+		return 0;
+	}
+
+	bool seek(int len) override
+	{
+		return len == 0;
+	}
+
+	bool isFinished() override
+	{
+		return true;
+	}
+
+private:
+	Slot& slot;
+};
+
+Slot* findSlot(const HttpRequest& request)
+{
+	auto stream = const_cast<HttpRequest&>(request).getBodyStream();
+	if(stream == nullptr) {
+		return nullptr;
+	}
+	for(auto& slot : slots) {
+		if(slot.stream == stream) {
+			return &slot;
+		}
+	}
+	return nullptr;
+}
+
+Slot* allocateSlot(HttpRequest& request)
+{
+	for(auto& slot : slots) {
+		if(slot.stream == nullptr) {
+			request.setBody(new SlotStream(slot));
+			return &slot;
+		}
+	}
+	return nullptr;
+}
+
+bool isApiRequest(const HttpRequest& request)
+{
+	// "/api..." or "/bridge<n>/api..."
+	auto path = request.uri.Path.c_str();
+	return strncmp(path, "/api", 4) == 0 || (strncmp(path, "/bridge", 7) == 0 && strstr(path, "/api") != nullptr);
+}
+
+/*
+ * Rules and schedules have nested definitions, so are buffered for parsing with ArduinoJson
+ */
+bool isParamRequest(const HttpRequest& request)
+{
+	auto path = request.uri.Path.c_str();
+	return strstr(path, "/rules") == nullptr && strstr(path, "/schedules") == nullptr;
+}
+
+} // namespace
+
+size_t bodyParser(HttpRequest& request, const char* at, int length)
+{
+	if(length == PARSE_DATASTART) {
+		if(!isApiRequest(request) || !isParamRequest(request)) {
+			return bodyToStringParser(request, at, length);
+		}
+		auto slot = allocateSlot(request);
+		if(slot == nullptr) {
+			debug_w("[HUE] No free body parser slot, buffering");
+			return bodyToStringParser(request, at, length);
+		}
+		slot->body.begin();
+		return 0;
+	}
+
+	auto slot = findSlot(request);
+	if(slot == nullptr) {
+		return bodyToStringParser(request, at, length);
+	}
+
+	if(length == PARSE_DATAEND) {
+		slot->body.end();
+		return 0;
+	}
+
+	return slot->body.parse(at, length) ? length : 0;
+}
+
+RequestBody* RequestBody::get(const HttpRequest& request)
+{
+	auto slot = findSlot(request);
+	return slot ? &slot->body : nullptr;
+}
+
+void RequestBody::release(const HttpRequest& request)
+{
+	if(findSlot(request) != nullptr) {
+		// Deleting the stream frees the slot
+		const_cast<HttpRequest&>(request).setBody(nullptr);
+	}
+}
+
+void RequestBody::begin()
+{
+	paramCount = 0;
+	overflow = false;
+	error = false;
+	deviceType[0] = '\0';
+	state = State::start;
+	escape = false;
+}
+
+bool RequestBody::parse(const char* data, size_t length)
+{
+	for(unsigned i = 0; i < length && !error; ++i) {
+		if(!parseChar(data[i])) {
+			debug_w("[HUE] Body syntax error at '%c', state %u", data[i], unsigned(state));
+			error = true;
+		}
+	}
+	return !error;
+}
+
+bool RequestBody::end()
+{
+	if(state != State::done && state != State::start) {
+		error = true;
+	}
+	return !error;
+}
+
+void RequestBody::setValue(Param::Type type, int32_t value)
+{
+	state = State::next;
+	if(paramCount >= maxParams) {
+		overflow = true;
+		return;
+	}
+	auto& param = params[paramCount++];
+	param.type = type;
+	param.value = value;
+}
+
+bool RequestBody::parseChar(char c)
+{
+	auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+
+	switch(state) {
+	case State::start:
+		if(isSpace(c)) {
+			return true;
+		}
+		if(c != '{') {
+			return false;
+		}
+		state = State::key;
+		return true;
+
+	case State::key:
+		if(isSpace(c)) {
+			return true;
+		}
+		if(c == '}' && paramCount == 0) {
+			state = State::done;
+			return true;
+		}
+		if(c != '"') {
+			return false;
+		}
+		keyLength = 0;
+		state = State::keyChars;
+		return true;
+
+	case State::keyChars: {
+		if(!escape && c == '"') {
+			if(paramCount < maxParams) {
+				auto& param = params[paramCount];
+				param.key[keyLength] = '\0';
+				if(!fromString(param.key, param.keyword)) {
+					param.keyword = Keyword::MAX;
+				}
+			}
+			state = State::colon;
+			return true;
+		}
+		if(!escape && c == '\\') {
+			escape = true;
+			return true;
+		}
+		escape = false;
+		if(paramCount < maxParams) {
+			if(keyLength < maxKeyLength) {
+				params[paramCount].key[keyLength++] = c;
+			} else {
+				// Truncated keys would match the wrong thing
+				params[paramCount].key[0] = '?';
+				overflow = true;
+			}
+		}
+		return true;
+	}
+
+	case State::colon:
+		if(isSpace(c)) {
+			return true;
+		}
+		if(c != ':') {
+			return false;
+		}
+		state = State::value;
+		return true;
+
+	case State::value:
+		if(isSpace(c)) {
+			return true;
+		}
+		if(c == '"') {
+			textLength = 0;
+			captureText = paramCount < maxParams && params[paramCount].keyword == Keyword::devicetype;
+			state = State::string;
+			return true;
+		}
+		if(c == '[' || c == '{') {
+			depth = 1;
+			state = State::nested;
+			return true;
+		}
+		if(c == '-' || isdigit(c)) {
+			negative = (c == '-');
+			fraction = false;
+			number = negative ? 0 : (c - '0');
+			state = State::number;
+			return true;
+		}
+		if(isalpha(c)) {
+			literal[0] = c;
+			textLength = 1;
+			state = State::literal;
+			return true;
+		}
+		return false;
+
+	case State::string: {
+		if(!escape && c == '"') {
+			if(captureText) {
+				deviceType[textLength] = '\0';
+			}
+			setValue(Param::Type::string, 0);
+			return true;
+		}
+		if(!escape && c == '\\') {
+			escape = true;
+			return true;
+		}
+		escape = false;
+		if(captureText && textLength < maxDeviceTypeLength) {
+			deviceType[textLength++] = c;
+		}
+		return true;
+	}
+
+	case State::literal:
+		if(isalpha(c)) {
+			if(textLength >= sizeof(literal) - 1) {
+				return false;
+			}
+			literal[textLength++] = c;
+			return true;
+		}
+		literal[textLength] = '\0';
+		if(strcmp(literal, "true") == 0) {
+			setValue(Param::Type::boolean, 1);
+		} else if(strcmp(literal, "false") == 0) {
+			setValue(Param::Type::boolean, 0);
+		} else if(strcmp(literal, "null") == 0) {
+			setValue(Param::Type::null, 0);
+		} else {
+			return false;
+		}
+		return parseChar(c);
+
+	case State::number:
+		if(isdigit(c)) {
+			// Ignore fractional part and exponent
+			if(!fraction && number < 100000000) {
+				number = (number * 10) + (c - '0');
+			}
+			return true;
+		}
+		if(c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+			fraction = true;
+			return true;
+		}
+		setValue(Param::Type::number, negative ? -number : number);
+		return parseChar(c);
+
+	case State::nested:
+		if(c == '"') {
+			state = State::nestedString;
+		} else if(c == '[' || c == '{') {
+			++depth;
+		} else if(c == ']' || c == '}') {
+			if(--depth == 0) {
+				setValue(Param::Type::nested, 0);
+			}
+		}
+		return true;
+
+	case State::nestedString:
+		if(escape) {
+			escape = false;
+		} else if(c == '\\') {
+			escape = true;
+		} else if(c == '"') {
+			state = State::nested;
+		}
+		return true;
+
+	case State::next:
+		if(isSpace(c)) {
+			return true;
+		}
+		if(c == ',') {
+			state = State::key;
+			return true;
+		}
+		if(c == '}') {
+			state = State::done;
+			return true;
+		}
+		return false;
+
+	case State::done:
+		return isSpace(c);
+
+	default:
+		return false;
+	}
+}
+
+} // namespace Hue
@@ -18,88 +18,242 @@
  ****/
 
 #include "ResponseStream.h"
+#include "ErrorResponse.h"
 
 namespace Hue
 {
-void ResponseStream::handleRequest(JsonDocument& request)
+void ResponseStream::handleRequest(const RequestBody& request)
 {
-	for(JsonPair pair : request.as<JsonObject>()) {
-		Device::Attribute attr;
-		const char* tag = pair.key().c_str();
-		if(fromString(tag, attr)) {
-			unsigned value;
-			if(attr == Device::Attribute::on) {
-				value = pair.value().as<bool>();
-			} else {
-				value = pair.value();
-			}
+	startTime = millis();
+	resultCount = request.paramCount;
+	for(unsigned i = 0; i < resultCount; ++i) {
+		auto& result = results[i];
+		result = Result{};
+		result.param = request.params[i];
 
-			debug_i("[HUE] Set '%s' = %u", tag, value);
-
-			auto callback = [this, attr](Status status, int errorCode) {
-				--outstandingRequests;
-				debug_i("ResponseStream::requestComplete, status = %d, errorCode = %d, outstanding = %u",
-						unsigned(status), errorCode, outstandingRequests);
-
-				if(status != Status::success) {
-					auto tag = toString(attr);
-					results[tag] = nullptr;
-				} else {
-					changed[attr] = true;
-				}
-
-				if(outstandingRequests == 0) {
-					generateResponse();
-					connection.send();
-				}
-			};
-
-			results[tag] = pair.value().as<String>();
-			auto status = device.setAttribute(attr, value, callback);
-			if(status == Status::pending) {
-				++outstandingRequests;
-				continue;
-			}
+		auto& param = result.param;
+		if(!isAttribute(param.keyword)) {
+			continue;
+		}
+		result.known = true;
+		if(param.type != RequestBody::Param::Type::boolean && param.type != RequestBody::Param::Type::number) {
+			continue;
+		}
 
-			if(status == Status::success) {
-				changed[attr] = true;
-				continue;
-			}
+		debug_i("[HUE] Set '%s' = %d", param.key, param.value);
+		issue(i);
+	}
+
+	if(outstandingRequests == 0) {
+		generateResponse();
+		return;
+	}
+
+	checkTimeouts();
+}
+
+void ResponseStream::issue(unsigned index)
+{
+	auto& result = results[index];
+	auto attr = Device::Attribute(result.param.keyword);
+	++result.attempts;
+	result.issueTime = millis();
+	if(result.attempts == 1) {
+		result.firstIssueTime = result.issueTime;
+	}
+
+	// Stream may be gone by the time device responds
+	auto callback = [guard = this->guard, index, issueTime = result.issueTime](Status status, int errorCode) {
+		debug_i("ResponseStream::requestComplete, status = %d, errorCode = %d", unsigned(status), errorCode);
+		auto stream = *guard;
+		if(stream != nullptr) {
+			stream->requestComplete(index, status, issueTime);
+		}
+	};
+
+	auto status = device.setAttribute(attr, result.param.value, callback);
+	if(status == Status::pending) {
+		if(!result.pending) {
+			result.pending = true;
+			++outstandingRequests;
+		}
+		result.waitingRetry = false;
+		result.deadline = result.issueTime + bridge.getRetryPolicy().getTimeout(bridge.getDeviceStats().find(device.getId()));
+		return;
+	}
+
+	if(result.pending) {
+		result.pending = false;
+		--outstandingRequests;
+	}
+	auto now = millis();
+	bridge.getDeviceStats().record(device.getId(), status, now - result.firstIssueTime, now - result.issueTime);
+	if(status == Status::success) {
+		result.success = true;
+		changed[attr] = true;
+	}
+}
+
+void ResponseStream::requestComplete(unsigned index, Status status, uint32_t issueTime)
+{
+	auto& result = results[index];
+	if(!result.pending) {
+		// Already completed by another attempt, or timed out
+		return;
+	}
+	// A late reply from an earlier attempt is as good as any other
+	result.pending = false;
+	--outstandingRequests;
+	debug_i("[HUE] Outstanding = %u", outstandingRequests);
+
+	// Latency includes any retries, as seen by the client; response time is for the attempt which replied
+	auto now = millis();
+	bridge.getDeviceStats().record(device.getId(), status, now - result.firstIssueTime, now - issueTime);
+	if(status == Status::success) {
+		result.success = true;
+		changed[Device::Attribute(result.param.keyword)] = true;
+	}
+
+	if(outstandingRequests == 0) {
+		timeoutTimer.stop();
+		generateResponse();
+		connection.send();
+	}
+}
+
+void ResponseStream::checkTimeouts()
+{
+	auto& policy = bridge.getRetryPolicy();
+	auto& stats = bridge.getDeviceStats();
+	auto id = device.getId();
+
+	auto now = millis();
+	for(unsigned i = 0; i < resultCount; ++i) {
+		auto& result = results[i];
+		if(!result.pending || int32_t(now - result.deadline) < 0) {
+			continue;
+		}
+
+		if(result.waitingRetry) {
+			debug_i("[HUE] Retry #%u '%s'", result.attempts, result.param.key);
+			issue(i);
+			continue;
 		}
 
-		results[tag] = nullptr;
+		// Statistics count each command once, at its final outcome
+		if(policy.canRetry(result.attempts, now - startTime, stats.find(id))) {
+			result.waitingRetry = true;
+			result.deadline = now + policy.getBackoff(result.attempts);
+			continue;
+		}
+
+		debug_w("[HUE] Device #%u timed out", id);
+		stats.timeout(id);
+		result.pending = false;
+		result.timedOut = true;
+		--outstandingRequests;
 	}
 
 	if(outstandingRequests == 0) {
 		generateResponse();
+		connection.send();
+		return;
+	}
+
+	// Wake at next deadline
+	uint32_t next{0};
+	bool first{true};
+	for(unsigned i = 0; i < resultCount; ++i) {
+		auto& result = results[i];
+		if(result.pending && (first || int32_t(result.deadline - next) < 0)) {
+			next = result.deadline;
+			first = false;
+		}
 	}
+	auto delay = int32_t(next - now);
+	timeoutTimer.initializeMs(std::max(delay, 1), [this]() { checkTimeouts(); });
+	timeoutTimer.startOnce();
 }
 
 void ResponseStream::generateResponse()
 {
 	bridge.deviceStateChanged(device, changed);
 
-	StaticJsonDocument<2048> doc;
-	doc.to<JsonArray>();
-	for(unsigned i = 0; i < results.count(); ++i) {
-		auto tag = results.keyAt(i);
-		auto value = results.valueAt(i);
-		if(value) {
-			auto obj = createSuccess(doc);
-			obj[path + "/" + tag] = value;
+	if(encoding == Encoding::msgpack) {
+		generateMsgPackResponse();
+		return;
+	}
+
+	// Write response directly: no document required
+	size_t len = print('[');
+	for(unsigned i = 0; i < resultCount; ++i) {
+		auto& result = results[i];
+		auto& param = result.param;
+		if(param.keyword == Keyword::transitiontime) {
+			// Accepted silently: devices change state immediately
+			continue;
+		}
+		if(len > 1) {
+			len += print(',');
+		}
+		String address = path + '/' + param.key;
+		if(!result.known) {
+			len += writeError(*this, Error::ParameterNotAvailable, address.c_str(),
+							  ErrorArgs().set(ErrorArg::parameter, param.key));
+		} else if(result.success) {
+			len += print(_F("{\"success\":{"));
+			len += writeJsonString(*this, address.c_str());
+			len += print(':');
+			if(param.type == RequestBody::Param::Type::boolean) {
+				len += print(param.value ? "true" : "false");
+			} else {
+				len += print(param.value);
+			}
+			len += print(_F("}}"));
 		} else {
-			String s = toString(Error::InternalError);
-			s.replace(F("<error_code>"), "-1");
-			createError(doc, path, Error::InternalError, s);
+			auto code = result.timedOut ? "timeout" : "-1";
+			len += writeError(*this, Error::InternalError, path.c_str(), ErrorArgs().set(ErrorArg::error_code, code));
 		}
 	}
-	size_t len = Json::serialize(doc, *this);
-	(void)len;
+	len += print(']');
 
 	//		stats.response.size += len;
 	debug_i("Serialized %d bytes", len);
 }
 
+void ResponseStream::generateMsgPackResponse()
+{
+	// Same content as JSON response
+	StaticJsonDocument<1024> doc;
+	doc.to<JsonArray>();
+	for(unsigned i = 0; i < resultCount; ++i) {
+		auto& result = results[i];
+		auto& param = result.param;
+		if(param.keyword == Keyword::transitiontime) {
+			continue;
+		}
+		String address = path + '/' + param.key;
+		if(!result.known) {
+			auto desc = getErrorDescription(Error::ParameterNotAvailable, ErrorArgs().set(ErrorArg::parameter, param.key));
+			createError(doc, address, Error::ParameterNotAvailable, desc);
+		} else if(result.success) {
+			auto success = createSuccess(doc);
+			if(param.type == RequestBody::Param::Type::boolean) {
+				success[address] = (param.value != 0);
+			} else {
+				success[address] = param.value;
+			}
+		} else {
+			auto code = result.timedOut ? "timeout" : "-1";
+			auto desc = getErrorDescription(Error::InternalError, ErrorArgs().set(ErrorArg::error_code, code));
+			createError(doc, path, Error::InternalError, desc);
+		}
+	}
+
+	auto len = serialize(doc, *this, encoding);
+	debug_i("Serialized %d bytes", len);
+}
+
 uint16_t ResponseStream::readMemoryBlock(char* data, int bufSize)
 {
 	auto count = MemoryDataStream::readMemoryBlock(data, bufSize);
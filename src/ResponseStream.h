@@ -22,23 +22,35 @@
 #include <Data/Stream/MemoryDataStream.h>
 #include <Network/Http/HttpRequest.h>
 #include "include/Hue/Bridge.h"
-#include <WHashMap.h>
+#include "Encoding.h"
+#include <Timer.h>
+#include <memory>
 
 namespace Hue
 {
 /*
  * Handles a command and generates asynchronous response stream.
  * This is populated only when all IO requests have been completed.
+ *
+ * Pending requests are retried according to the bridge `RetryPolicy`.
  */
 class ResponseStream : public MemoryDataStream
 {
 public:
-	ResponseStream(Bridge& bridge, Device& device, HttpServerConnection& connection, String& path)
-		: bridge(bridge), device(device), connection(connection), path(path)
+	ResponseStream(Bridge& bridge, Device& device, HttpServerConnection& connection, String& path,
+				   Encoding encoding = Encoding::json)
+		: bridge(bridge), device(device), connection(connection), path(path), encoding(encoding),
+		  guard(std::make_shared<ResponseStream*>(this))
 	{
 	}
 
-	void handleRequest(JsonDocument& request);
+	~ResponseStream()
+	{
+		// Device callbacks may still be outstanding
+		*guard = nullptr;
+	}
+
+	void handleRequest(const RequestBody& request);
 
 	int available() override
 	{
@@ -53,14 +65,40 @@ public:
 
 	uint16_t readMemoryBlock(char* data, int bufSize) override;
 
+	/**
+	 * @brief Admission held for the lifetime of this stream
+	 */
+	AdmissionControl::Ticket ticket;
+
 private:
+	void issue(unsigned index);
+	void requestComplete(unsigned index, Status status, uint32_t issueTime);
+	void checkTimeouts();
 	void generateResponse();
+	void generateMsgPackResponse();
 
 	Bridge& bridge;
 	Device& device;
 	HttpServerConnection& connection;
 	String path;
-	HashMap<String, String> results;
+	Encoding encoding;
+	struct Result {
+		RequestBody::Param param;
+		bool known;	///< Parameter recognised
+		bool success; ///< Action completed successfully
+		bool pending;		  ///< Waiting for device, or to retry
+		bool waitingRetry;	///< Backing off before retry
+		bool timedOut;
+		uint8_t attempts;
+		uint32_t firstIssueTime; ///< When first attempt was made, for measuring latency
+		uint32_t issueTime;		 ///< When current attempt was made
+		uint32_t deadline;		 ///< When current attempt times out, or retry is due
+	};
+	Result results[RequestBody::maxParams];
+	uint8_t resultCount{0};
+	std::shared_ptr<ResponseStream*> guard; ///< Lets callbacks detect that stream has been destroyed
+	Timer timeoutTimer;
+	uint32_t startTime{0};
 	uint8_t outstandingRequests{0};
 	Device::Attributes changed;
 };
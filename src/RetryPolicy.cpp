@@ -0,0 +1,33 @@
+/**
+ * RetryPolicy.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/RetryPolicy.h"
+
+namespace Hue
+{
+uint32_t RetryPolicy::getTimeout(const DeviceStats::Entry* stats) const
+{
+	uint32_t timeout = config.initialTimeout;
+	if(stats != nullptr && stats->commands > stats->timeouts) {
+		timeout = stats->percentile(config.percentile) * config.factor;
+	}
+	return std::max(uint32_t(config.minTimeout), std::min(timeout, uint32_t(config.maxTimeout)));
+}
+
+} // namespace Hue
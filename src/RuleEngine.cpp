@@ -0,0 +1,502 @@
+/**
+ * RuleEngine.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/RuleEngine.h"
+#include "include/Hue/Bridge.h"
+#include "include/Hue/Keyword.h"
+#include "Strings.h"
+#include <Data/CStringArray.h>
+#include <SystemClock.h>
+#include <memory>
+
+namespace Hue
+{
+namespace
+{
+#define XX(tag) #tag "\0"
+DEFINE_FSTR_LOCAL(fstrOperators, HUE_RULE_OPERATOR_MAP(XX))
+#undef XX
+
+// State keys for each sensor type, followed by `lastupdated`
+#define XX(tag, typeName, modelid, cluster, stateKey) #stateKey "\0"
+DEFINE_FSTR_LOCAL(fstrSensorKeys, HUE_SENSOR_TYPE_MAP(XX) "lastupdated\0")
+#undef XX
+
+constexpr uint8_t sensorLastUpdated{0
+#define XX(...) +1
+									HUE_SENSOR_TYPE_MAP(XX)
+#undef XX
+};
+
+using Source = RuleEngine::Condition::Source;
+
+/*
+ * Split "[/api/<username>]/lights/<id>/state[/<key>]"
+ */
+bool parseAddress(const char* address, Source& source, uint32_t& id, String& key)
+{
+	String path(address);
+	path.replace('/', '\0');
+	CStringArray segments(path);
+	if(segments.count() < 2 || segments[0][0] != '\0') {
+		return false;
+	}
+	// Schedule commands include the API prefix
+	unsigned i = (F("api") == segments[1]) ? 3 : 1;
+	if(segments.count() < i + 3 || F("state") != segments[i + 2]) {
+		return false;
+	}
+	if(F("lights") == segments[i]) {
+		source = Source::light;
+	} else if(F("sensors") == segments[i]) {
+		source = Source::sensor;
+	} else {
+		return false;
+	}
+	id = String(segments[i + 1]).toInt();
+	key = (segments.count() > i + 3) ? segments[i + 3] : nullptr;
+	return id != 0;
+}
+
+bool parseKey(Source source, const String& name, uint8_t& key)
+{
+	if(source == Source::sensor) {
+		int i = CStringArray(fstrSensorKeys).indexOf(name);
+		if(i < 0) {
+			return false;
+		}
+		key = i;
+		return true;
+	}
+
+	Keyword kw;
+	if(!fromString(name.c_str(), kw) || !isAttribute(kw)) {
+		return false;
+	}
+	key = uint8_t(kw);
+	return true;
+}
+
+bool parseValue(JsonVariantConst var, int32_t& value)
+{
+	if(var.is<bool>()) {
+		value = var.as<bool>();
+		return true;
+	}
+	if(var.is<int>()) {
+		value = var.as<int>();
+		return true;
+	}
+	// Hue specifies condition values as strings
+	String s = var.as<const char*>();
+	if(s == F("true")) {
+		value = 1;
+	} else if(s == F("false")) {
+		value = 0;
+	} else if(s.length() != 0 && (isdigit(s[0]) || s[0] == '-')) {
+		value = s.toInt();
+	} else {
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+RuleEngine::~RuleEngine()
+{
+	for(auto rule : rules) {
+		delete rule;
+	}
+}
+
+bool RuleEngine::create(JsonObjectConst json, const String& owner, unsigned& id, Error& error, String& parameter,
+						String& value)
+{
+	unsigned slot = 0;
+	while(slot < maxRules && rules[slot] != nullptr) {
+		++slot;
+	}
+	if(slot == maxRules) {
+		error = Error::RuleEngineFull;
+		return false;
+	}
+
+	auto invalid = [&](const String& param, JsonVariantConst var) {
+		error = Error::InvalidValue;
+		parameter = param;
+		value = Json::serialize(var);
+		return false;
+	};
+
+	JsonArrayConst conditions = json[FS_conditions];
+	JsonArrayConst actions = json[FS_actions];
+	if(conditions.isNull() || actions.isNull() || conditions.size() == 0 || actions.size() == 0) {
+		error = Error::MissingParameters;
+		return false;
+	}
+	if(conditions.size() > maxConditions) {
+		return invalid(FS_conditions, conditions);
+	}
+	if(actions.size() > maxActions) {
+		return invalid(FS_actions, actions);
+	}
+
+	std::unique_ptr<Rule> rule(new Rule{});
+	rule->id = slot + 1;
+	rule->enabled = true;
+	rule->created = SystemClock.now(eTZ_UTC);
+	rule->name = json[FS_name] | "";
+	rule->owner = owner;
+
+	for(JsonObjectConst jc : conditions) {
+		auto& cond = rule->conditions[rule->conditionCount++];
+		String key;
+		if(!parseAddress(jc[FS_address], cond.source, cond.id, key) || !parseKey(cond.source, key, cond.key)) {
+			return invalid(F("conditions/address"), jc[FS_address]);
+		}
+		int op = CStringArray(fstrOperators).indexOf(jc[FS_operator].as<const char*>());
+		if(op < 0) {
+			return invalid(F("conditions/operator"), jc[FS_operator]);
+		}
+		cond.op = Condition::Operator(op);
+		if(cond.op == Condition::Operator::dx) {
+			continue;
+		}
+		if(cond.source == Source::sensor && cond.key == sensorLastUpdated) {
+			// Only change detection is supported on timestamps
+			return invalid(F("conditions/operator"), jc[FS_operator]);
+		}
+		if(!parseValue(jc[FS_value], cond.value)) {
+			return invalid(F("conditions/value"), jc[FS_value]);
+		}
+	}
+
+	for(JsonObjectConst ja : actions) {
+		auto& action = rule->actions[rule->actionCount++];
+		String param;
+		JsonVariantConst var;
+		if(!parseAction(ja, action, param, var)) {
+			return invalid(F("actions/") + param, var);
+		}
+	}
+
+	id = rule->id;
+	rules[slot] = rule.release();
+	buildIndex();
+	debug_i("[HUE] Created rule #%u '%s'", id, rules[slot]->name.c_str());
+	return true;
+}
+
+bool RuleEngine::parseAction(JsonObjectConst json, Action& action, String& parameter, JsonVariantConst& value)
+{
+	auto invalid = [&](const String& param, JsonVariantConst var) {
+		parameter = param;
+		value = var;
+		return false;
+	};
+
+	Source source;
+	String key;
+	if(!parseAddress(json[FS_address], source, action.id, key) || source != Source::light || key) {
+		return invalid(FS_address, json[FS_address]);
+	}
+	if(F("PUT") != json[FS_method].as<const char*>()) {
+		return invalid(FS_method, json[FS_method]);
+	}
+	JsonObjectConst body = json[FS_body];
+	if(body.isNull() || body.size() == 0) {
+		return invalid(FS_body, json[FS_body]);
+	}
+	for(JsonPairConst kv : body) {
+		Keyword kw;
+		int32_t v;
+		if(!fromString(kv.key().c_str(), kw) || !isAttribute(kw) || !parseValue(kv.value(), v)) {
+			return invalid(FS_body, kv.value());
+		}
+		auto attr = Device::Attribute(kw);
+		action.attributes[attr] = true;
+		action.values[unsigned(attr)] = v;
+	}
+	return true;
+}
+
+bool RuleEngine::remove(unsigned id)
+{
+	if(id == 0 || id > maxRules || rules[id - 1] == nullptr) {
+		return false;
+	}
+	delete rules[id - 1];
+	rules[id - 1] = nullptr;
+	buildIndex();
+	return true;
+}
+
+const RuleEngine::Rule* RuleEngine::find(unsigned id) const
+{
+	return (id == 0 || id > maxRules) ? nullptr : rules[id - 1];
+}
+
+void RuleEngine::buildIndex()
+{
+	auto less = [](const Watch& a, const Watch& b) {
+		if(a.source != b.source) {
+			return a.source < b.source;
+		}
+		if(a.id != b.id) {
+			return a.id < b.id;
+		}
+		return a.key < b.key;
+	};
+
+	watchCount = 0;
+	for(unsigned i = 0; i < maxRules; ++i) {
+		auto rule = rules[i];
+		if(rule == nullptr) {
+			continue;
+		}
+		for(unsigned c = 0; c < rule->conditionCount; ++c) {
+			auto& cond = rule->conditions[c];
+			Watch w{cond.id, cond.source, cond.key, uint8_t(i)};
+			// Insertion sort: rules change rarely
+			unsigned pos = watchCount++;
+			while(pos > 0 && less(w, watches[pos - 1])) {
+				watches[pos] = watches[pos - 1];
+				--pos;
+			}
+			watches[pos] = w;
+		}
+	}
+}
+
+void RuleEngine::lightChanged(Device::ID id, Device::Attributes changed)
+{
+	processEvent(Event{Source::light, id, changed.value()});
+}
+
+void RuleEngine::sensorChanged(const Sensor& sensor)
+{
+	// Value and timestamp both change on update
+	uint32_t keys = (1U << unsigned(sensor.getType())) | (1U << sensorLastUpdated);
+	processEvent(Event{Source::sensor, sensor.getId(), keys});
+}
+
+void RuleEngine::processEvent(const Event& event)
+{
+	if(dispatching || watchCount == 0) {
+		return;
+	}
+
+	// Binary search for first watch on this source/id
+	unsigned lo = 0;
+	unsigned hi = watchCount;
+	while(lo < hi) {
+		unsigned mid = (lo + hi) / 2;
+		auto& w = watches[mid];
+		if(w.source < event.source || (w.source == event.source && w.id < event.id)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	// Collect affected rules
+	uint32_t candidates{0};
+	for(unsigned i = lo; i < watchCount; ++i) {
+		auto& w = watches[i];
+		if(w.source != event.source || w.id != event.id) {
+			break;
+		}
+		if(event.keys & (1U << w.key)) {
+			candidates |= 1U << w.rule;
+		}
+	}
+
+	for(unsigned i = 0; candidates != 0; ++i, candidates >>= 1) {
+		if((candidates & 1) == 0) {
+			continue;
+		}
+		auto rule = rules[i];
+		if(rule == nullptr || !rule->enabled) {
+			continue;
+		}
+		bool match{true};
+		for(unsigned c = 0; match && c < rule->conditionCount; ++c) {
+			match = evaluate(rule->conditions[c], event);
+		}
+		if(match) {
+			trigger(*rule);
+		}
+	}
+}
+
+bool RuleEngine::evaluate(const Condition& cond, const Event& event)
+{
+	if(cond.op == Condition::Operator::dx) {
+		return cond.source == event.source && cond.id == event.id && (event.keys & (1U << cond.key));
+	}
+
+	int32_t current;
+	if(cond.source == Source::light) {
+		auto device = bridge.getDevices().find(cond.id);
+		unsigned value;
+		if(device == nullptr || !device->getAttribute(Device::Attribute(cond.key), value)) {
+			return false;
+		}
+		current = value;
+	} else {
+		auto sensors = bridge.getSensors();
+		auto sensor = sensors ? sensors->find(cond.id) : nullptr;
+		if(sensor == nullptr) {
+			return false;
+		}
+		current = sensor->getValue();
+	}
+
+	switch(cond.op) {
+	case Condition::Operator::eq:
+		return current == cond.value;
+	case Condition::Operator::gt:
+		return current > cond.value;
+	case Condition::Operator::lt:
+		return current < cond.value;
+	default:
+		return false;
+	}
+}
+
+void RuleEngine::trigger(Rule& rule)
+{
+	debug_i("[HUE] Rule #%u '%s' triggered", rule.id, rule.name.c_str());
+	++rule.timesTriggered;
+	rule.lastTriggered = SystemClock.now(eTZ_UTC);
+
+	dispatching = true;
+	for(unsigned a = 0; a < rule.actionCount; ++a) {
+		execute(rule.actions[a]);
+	}
+	dispatching = false;
+}
+
+void RuleEngine::execute(const Action& action)
+{
+	auto device = bridge.getDevices().find(action.id);
+	if(device == nullptr) {
+		return;
+	}
+
+	// Apply all attributes, then notify once
+	Device::Attributes changed;
+	for(unsigned i = 0; i < Action::attributeCount; ++i) {
+		auto attr = Device::Attribute(i);
+		if(!action.attributes[attr]) {
+			continue;
+		}
+		auto id = action.id;
+		auto result = device->setAttribute(attr, action.values[i], [this, id, attr](Status status, int) {
+			auto dev = bridge.getDevices().find(id);
+			if(status == Status::success && dev != nullptr) {
+				Device::Attributes attrs;
+				attrs[attr] = true;
+				// Change originated from a rule, so must not be evaluated again even when completed later
+				auto wasDispatching = dispatching;
+				dispatching = true;
+				bridge.deviceStateChanged(*dev, attrs);
+				dispatching = wasDispatching;
+			}
+		});
+		if(result == Status::success) {
+			changed[attr] = true;
+		}
+	}
+	if(changed.any()) {
+		bridge.deviceStateChanged(*device, changed);
+	}
+}
+
+void RuleEngine::getInfo(const Rule& rule, JsonObject json) const
+{
+	CStringArray operators(fstrOperators);
+	CStringArray sensorKeys(fstrSensorKeys);
+
+	json[FS_name] = rule.name;
+	json[FS_owner] = rule.owner;
+	json[FS_created] = formatTime(rule.created);
+	json[FS_lasttriggered] = formatTime(rule.lastTriggered);
+	json[FS_timestriggered] = rule.timesTriggered;
+	json[FS_status] = rule.enabled ? FS_enabled : FS_disabled;
+
+	auto conditions = json.createNestedArray(FS_conditions);
+	for(unsigned c = 0; c < rule.conditionCount; ++c) {
+		auto& cond = rule.conditions[c];
+		auto jc = conditions.createNestedObject();
+		String address;
+		address += '/';
+		if(cond.source == Source::light) {
+			address += FS_lights;
+			address += '/';
+			address += cond.id;
+			address += _F("/state/");
+			address += getKeywordName(Keyword(cond.key));
+		} else {
+			address += FS_sensors;
+			address += '/';
+			address += cond.id;
+			address += _F("/state/");
+			address += sensorKeys[cond.key];
+		}
+		jc[FS_address] = address;
+		jc[FS_operator] = operators[unsigned(cond.op)];
+		if(cond.op != Condition::Operator::dx) {
+			jc[FS_value] = String(cond.value);
+		}
+	}
+
+	auto actions = json.createNestedArray(FS_actions);
+	for(unsigned a = 0; a < rule.actionCount; ++a) {
+		getActionInfo(rule.actions[a], actions.createNestedObject());
+	}
+}
+
+void RuleEngine::getActionInfo(const Action& action, JsonObject json)
+{
+	String address;
+	address += '/';
+	address += FS_lights;
+	address += '/';
+	address += action.id;
+	address += _F("/state");
+	json[FS_address] = address;
+	json[FS_method] = F("PUT");
+	auto body = json.createNestedObject(FS_body);
+	for(unsigned i = 0; i < Action::attributeCount; ++i) {
+		auto attr = Device::Attribute(i);
+		if(!action.attributes[attr]) {
+			continue;
+		}
+		auto tag = getKeywordName(Keyword(attr));
+		if(attr == Device::Attribute::on) {
+			body[tag] = (action.values[i] != 0);
+		} else {
+			body[tag] = action.values[i];
+		}
+	}
+}
+
+} // namespace Hue
@@ -0,0 +1,68 @@
+/**
+ * RuleListStream.cpp - Support for streaming Hue rule information in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "RuleListStream.h"
+
+namespace Hue
+{
+bool RuleListStream::getContent(String& content)
+{
+	switch(state) {
+	case State::start:
+		content = '{';
+		state = State::rules;
+		return true;
+
+	case State::rules: {
+		// Rules may be deleted whilst listing so locate by slot
+		const RuleEngine::Rule* rule{nullptr};
+		while(rule == nullptr && index < RuleEngine::maxRules) {
+			rule = rules.getRule(index++);
+		}
+		if(rule == nullptr) {
+			content = '}';
+			state = State::done;
+			return true;
+		}
+
+		StaticJsonDocument<2048> doc;
+		rules.getInfo(*rule, doc.to<JsonObject>());
+		if(!first) {
+			content = ',';
+		}
+		first = false;
+		content += '"';
+		content += rule->id;
+		content += "\":";
+		content += Json::serialize(doc);
+		return true;
+	}
+
+	case State::done:
+	default:
+		return false;
+	}
+}
+
+String RuleListStream::getName() const
+{
+	return _F("rules.json");
+}
+
+} // namespace Hue
@@ -0,0 +1,55 @@
+/****
+ * RuleListStream.h - Support for streaming Hue rule information in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "ChunkedStream.h"
+#include "include/Hue/RuleEngine.h"
+
+namespace Hue
+{
+/**
+ * @brief A forward-only stream for listing rules
+ * @note Rules are output one at a time
+ */
+class RuleListStream : public ChunkedStream
+{
+public:
+	RuleListStream(const RuleEngine& rules) : rules(rules)
+	{
+	}
+
+	bool getContent(String& content) override;
+
+	String getName() const override;
+
+private:
+	enum class State {
+		start,
+		rules,
+		done,
+	};
+
+	const RuleEngine& rules;
+	State state{State::start};
+	uint8_t index{0};
+	bool first{true};
+};
+
+} // namespace Hue
@@ -0,0 +1,68 @@
+/**
+ * ScheduleListStream.cpp - Support for streaming Hue schedule information in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "ScheduleListStream.h"
+
+namespace Hue
+{
+bool ScheduleListStream::getContent(String& content)
+{
+	switch(state) {
+	case State::start:
+		content = '{';
+		state = State::schedules;
+		return true;
+
+	case State::schedules: {
+		// Schedules may be deleted whilst listing so locate by slot
+		const Schedules::Schedule* schedule{nullptr};
+		while(schedule == nullptr && index < Schedules::maxSchedules) {
+			schedule = schedules.getSchedule(index++);
+		}
+		if(schedule == nullptr) {
+			content = '}';
+			state = State::done;
+			return true;
+		}
+
+		StaticJsonDocument<2048> doc;
+		schedules.getInfo(*schedule, doc.to<JsonObject>());
+		if(!first) {
+			content = ',';
+		}
+		first = false;
+		content += '"';
+		content += schedule->id;
+		content += "\":";
+		content += Json::serialize(doc);
+		return true;
+	}
+
+	case State::done:
+	default:
+		return false;
+	}
+}
+
+String ScheduleListStream::getName() const
+{
+	return _F("schedules.json");
+}
+
+} // namespace Hue
@@ -0,0 +1,55 @@
+/****
+ * ScheduleListStream.h - Support for streaming Hue schedule information in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "ChunkedStream.h"
+#include "include/Hue/Schedules.h"
+
+namespace Hue
+{
+/**
+ * @brief A forward-only stream for listing schedules
+ * @note Schedule lists can be large so we only output one schedule at a time
+ */
+class ScheduleListStream : public ChunkedStream
+{
+public:
+	ScheduleListStream(const Schedules& schedules) : schedules(schedules)
+	{
+	}
+
+	bool getContent(String& content) override;
+
+	String getName() const override;
+
+private:
+	enum class State {
+		start,
+		schedules,
+		done,
+	};
+
+	const Schedules& schedules;
+	State state{State::start};
+	uint16_t index{0};
+	bool first{true};
+};
+
+} // namespace Hue
@@ -0,0 +1,500 @@
+/**
+ * Schedules.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/Schedules.h"
+#include "include/Hue/Bridge.h"
+#include "Strings.h"
+#include <FileSystem.h>
+#include <SystemClock.h>
+#include <DateTime.h>
+#include <memory>
+#include <algorithm>
+
+namespace Hue
+{
+namespace
+{
+using Type = Schedules::Schedule::Type;
+
+constexpr uint32_t secondsPerDay{24 * 60 * 60};
+
+bool parseTimeOfDay(const char* s, uint32_t& seconds)
+{
+	unsigned hour, minute, second;
+	if(sscanf(s, "%2u:%2u:%2u", &hour, &minute, &second) != 3 || hour > 23 || minute > 59 || second > 59) {
+		return false;
+	}
+	seconds = (hour * 60 + minute) * 60 + second;
+	return true;
+}
+
+/*
+ * Parse `localtime` into schedule
+ */
+bool parseLocalTime(const char* s, Schedules::Schedule& schedule)
+{
+	if(s == nullptr) {
+		return false;
+	}
+
+	if(s[0] == 'W') {
+		// "W<bbb>/Thh:mm:ss"
+		char* end;
+		auto days = strtoul(&s[1], &end, 10);
+		if(days == 0 || days > 127 || strncmp(end, "/T", 2) != 0) {
+			return false;
+		}
+		schedule.type = Type::weekly;
+		schedule.weekdays = days;
+		return parseTimeOfDay(&end[2], schedule.time);
+	}
+
+	if(s[0] == 'R') {
+		// "R[nn]/PThh:mm:ss"
+		char* end;
+		auto repeat = strtoul(&s[1], &end, 10);
+		if(repeat > 99 || *end != '/') {
+			return false;
+		}
+		schedule.recurring = true;
+		schedule.repeat = repeat;
+		s = &end[1];
+	}
+
+	if(s[0] == 'P') {
+		// "PThh:mm:ss"
+		if(s[1] != 'T' || !parseTimeOfDay(&s[2], schedule.time) || schedule.time == 0) {
+			return false;
+		}
+		schedule.type = Type::timer;
+		return true;
+	}
+
+	if(schedule.recurring) {
+		return false;
+	}
+
+	// "YYYY-MM-DDThh:mm:ss"
+	unsigned year, month, day, hour, minute, second;
+	if(sscanf(s, "%4u-%2u-%2uT%2u:%2u:%2u", &year, &month, &day, &hour, &minute, &second) != 6 || month == 0 ||
+	   month > 12 || day == 0 || day > 31 || hour > 23 || minute > 59 || second > 59) {
+		return false;
+	}
+	schedule.type = Type::absolute;
+	schedule.time = DateTime::toUnixTime(second, minute, hour, day, month - 1, year);
+	return true;
+}
+
+String formatLocalTime(const Schedules::Schedule& schedule)
+{
+	auto hms = [](char* buf, uint32_t secs) {
+		m_snprintf(buf, 9, "%02u:%02u:%02u", secs / 3600, (secs / 60) % 60, secs % 60);
+	};
+
+	char buf[32];
+	switch(schedule.type) {
+	case Type::weekly: {
+		auto n = m_snprintf(buf, sizeof(buf), "W%03u/T", schedule.weekdays);
+		hms(&buf[n], schedule.time);
+		return buf;
+	}
+	case Type::timer: {
+		unsigned n{0};
+		if(schedule.recurring) {
+			n = schedule.repeat ? m_snprintf(buf, sizeof(buf), "R%02u/", schedule.repeat) : m_snprintf(buf, 3, "R/");
+		}
+		buf[n++] = 'P';
+		buf[n++] = 'T';
+		hms(&buf[n], schedule.time);
+		return buf;
+	}
+	case Type::absolute:
+	default:
+		return formatTime(schedule.time);
+	}
+}
+
+/*
+ * Bit for day of week in `weekdays`: Monday is bit 6, Sunday is bit 0
+ */
+uint8_t getDayBit(uint32_t day)
+{
+	// Day 0 (1 Jan 1970) was a Thursday
+	auto dow = (day + 4) % 7;
+	return (dow == 0) ? 0x01 : 0x80 >> dow;
+}
+
+/*
+ * Check a record loaded from file is one `create()` could have produced
+ */
+bool isValid(const Schedules::Schedule& schedule)
+{
+	switch(schedule.type) {
+	case Type::absolute:
+		return !schedule.recurring;
+	case Type::weekly:
+		return schedule.weekdays != 0 && schedule.weekdays <= 127 && schedule.time < secondsPerDay;
+	case Type::timer:
+		if(schedule.time == 0 || schedule.time >= secondsPerDay || schedule.repeat > 99) {
+			return false;
+		}
+		// A finished timer is disabled with no triggers remaining
+		return !schedule.recurring || schedule.repeat == 0 || !schedule.enabled ||
+			   (schedule.remaining != 0 && schedule.remaining <= schedule.repeat);
+	default:
+		return false;
+	}
+}
+
+} // namespace
+
+Schedules::~Schedules()
+{
+	for(auto schedule : schedules) {
+		delete schedule;
+	}
+}
+
+void Schedules::open(const String& filename)
+{
+	this->filename = filename;
+
+	/*
+	 * A leftover temporary file means `save()` was interrupted. If the main file is still there
+	 * the temporary one may be incomplete, otherwise it's the only copy.
+	 */
+	String tmpName = filename + ".tmp";
+	if(fileExist(tmpName)) {
+		if(fileExist(filename)) {
+			fileDelete(tmpName);
+		} else if(fileRename(tmpName.c_str(), filename.c_str()) < 0) {
+			debug_e("[HUE] Failed to recover '%s'", tmpName.c_str());
+		} else {
+			debug_w("[HUE] Recovered schedules from '%s'", tmpName.c_str());
+		}
+	}
+
+	file_t file = fileOpen(filename, eFO_ReadOnly);
+	if(file < 0) {
+		debug_i("[HUE] No schedules '%s'", filename.c_str());
+		return;
+	}
+
+	Header header;
+	if(fileRead(file, &header, sizeof(header)) != int(sizeof(header)) || header.magic != Header::magicValue ||
+	   header.recordSize != sizeof(Schedule)) {
+		debug_w("[HUE] Schedules '%s' invalid", filename.c_str());
+		fileClose(file);
+		return;
+	}
+
+	unsigned count{0};
+	for(unsigned i = 0; i < header.recordCount; ++i) {
+		std::unique_ptr<Schedule> schedule(new Schedule);
+		if(fileRead(file, schedule.get(), sizeof(Schedule)) != int(sizeof(Schedule))) {
+			break;
+		}
+		auto id = schedule->id;
+		if(id == 0 || id > maxSchedules || schedules[id - 1] != nullptr || !isValid(*schedule)) {
+			debug_w("[HUE] Ignoring invalid schedule #%u", id);
+			continue;
+		}
+		schedule->name[sizeof(schedule->name) - 1] = '\0';
+		schedules[id - 1] = schedule.release();
+		++count;
+	}
+	fileClose(file);
+
+	debug_i("[HUE] Loaded %u schedules", count);
+	update();
+}
+
+bool Schedules::save()
+{
+	if(!filename) {
+		return true;
+	}
+
+	unsigned count{0};
+	for(auto schedule : schedules) {
+		if(schedule != nullptr) {
+			++count;
+		}
+	}
+
+	/*
+	 * Write to temporary file so a power failure doesn't lose existing schedules.
+	 * Rename can't replace an existing file, so `open()` deals with an interruption between the two steps.
+	 */
+	String tmpName = filename + ".tmp";
+	file_t file = fileOpen(tmpName, eFO_CreateNewAlways | eFO_WriteOnly);
+	if(file < 0) {
+		debug_e("[HUE] Failed to create '%s'", tmpName.c_str());
+		return false;
+	}
+	Header header{Header::magicValue, uint16_t(count), sizeof(Schedule)};
+	bool ok = fileWrite(file, &header, sizeof(header)) == int(sizeof(header));
+	for(unsigned i = 0; ok && i < maxSchedules; ++i) {
+		if(schedules[i] != nullptr) {
+			ok = fileWrite(file, schedules[i], sizeof(Schedule)) == int(sizeof(Schedule));
+		}
+	}
+	fileClose(file);
+	if(ok) {
+		fileDelete(filename);
+		ok = fileRename(tmpName.c_str(), filename.c_str()) >= 0;
+	}
+	if(!ok) {
+		debug_e("[HUE] Failed to write schedules");
+		fileDelete(tmpName);
+		return false;
+	}
+
+	debug_i("[HUE] Saved %u schedules", count);
+	return true;
+}
+
+bool Schedules::create(JsonObjectConst json, unsigned& id, Error& error, String& parameter, String& value)
+{
+	unsigned slot = 0;
+	while(slot < maxSchedules && schedules[slot] != nullptr) {
+		++slot;
+	}
+	if(slot == maxSchedules) {
+		error = Error::ScheduleListFull;
+		return false;
+	}
+
+	auto invalid = [&](const String& param, JsonVariantConst var) {
+		error = Error::InvalidValue;
+		parameter = param;
+		value = Json::serialize(var);
+		return false;
+	};
+
+	JsonObjectConst command = json[FS_command];
+	JsonVariantConst localtime = json[FS_localtime];
+	if(localtime.isNull()) {
+		// Deprecated, but still used by some apps
+		localtime = json[FS_time];
+	}
+	if(command.isNull() || localtime.isNull()) {
+		error = Error::MissingParameters;
+		return false;
+	}
+
+	std::unique_ptr<Schedule> schedule(new Schedule{});
+	schedule->id = slot + 1;
+	schedule->created = SystemClock.now(eTZ_UTC);
+	strncpy(schedule->name, json[FS_name] | "schedule", sizeof(schedule->name) - 1);
+
+	if(!parseLocalTime(localtime, *schedule)) {
+		return invalid(FS_localtime, localtime);
+	}
+
+	String param;
+	JsonVariantConst var;
+	if(!RuleEngine::parseAction(command, schedule->command, param, var)) {
+		return invalid(F("command/") + param, var);
+	}
+
+	JsonVariantConst status = json[FS_status];
+	if(status.isNull() || F("enabled") == status.as<const char*>()) {
+		schedule->enabled = true;
+	} else if(F("disabled") != status.as<const char*>()) {
+		return invalid(FS_status, status);
+	}
+
+	// Recurring schedules are kept by default
+	bool recurring = schedule->type == Type::weekly || schedule->recurring;
+	schedule->autodelete = json[FS_autodelete] | !recurring;
+	schedule->remaining = schedule->repeat;
+	schedule->startTime = SystemClock.now(eTZ_Local);
+
+	id = schedule->id;
+	schedules[slot] = schedule.release();
+	debug_i("[HUE] Created schedule #%u '%s'", id, schedules[slot]->name);
+	save();
+	if(started) {
+		arm(slot);
+	}
+	update();
+	return true;
+}
+
+bool Schedules::remove(unsigned id)
+{
+	if(find(id) == nullptr) {
+		return false;
+	}
+	wheel.remove(id - 1);
+	delete schedules[id - 1];
+	schedules[id - 1] = nullptr;
+	save();
+	update();
+	return true;
+}
+
+void Schedules::arm(unsigned index)
+{
+	auto schedule = schedules[index];
+	if(schedule == nullptr || !schedule->enabled) {
+		wheel.remove(index);
+		return;
+	}
+
+	auto now = wheel.getTime();
+	uint32_t expires{0};
+	switch(schedule->type) {
+	case Type::weekly: {
+		// Find next matching day, which may be today
+		auto day = now / secondsPerDay;
+		for(unsigned i = 0; i <= 7; ++i, ++day) {
+			expires = day * secondsPerDay + schedule->time;
+			if(expires > now && (schedule->weekdays & getDayBit(day))) {
+				break;
+			}
+		}
+		break;
+	}
+	case Type::timer:
+		expires = schedule->startTime + schedule->time;
+		if(schedule->recurring && int32_t(expires - now) <= 0) {
+			/*
+			 * Progress isn't saved on each trigger, so after a restart this catches up
+			 * with the saved start time. Periods elapsed whilst powered off count as triggered,
+			 * except the last one of a limited timer which remains due.
+			 */
+			auto periods = (now - schedule->startTime) / schedule->time;
+			if(schedule->repeat != 0) {
+				periods = std::min(periods, schedule->remaining - 1U);
+				schedule->remaining -= periods;
+			}
+			schedule->startTime += periods * schedule->time;
+			expires = schedule->startTime + schedule->time;
+		}
+		break;
+	case Type::absolute:
+	default:
+		expires = schedule->time;
+	}
+
+	// Anything overdue is triggered on the next tick
+	wheel.add(index, expires);
+}
+
+void Schedules::expired(unsigned index)
+{
+	auto schedule = schedules[index];
+	if(schedule == nullptr) {
+		return;
+	}
+
+	debug_i("[HUE] Schedule #%u '%s' triggered", schedule->id, schedule->name);
+	bridge.getRules().execute(schedule->command);
+
+	switch(schedule->type) {
+	case Type::weekly:
+		arm(index);
+		return;
+
+	case Type::timer:
+		if(schedule->recurring && (schedule->repeat == 0 || --schedule->remaining != 0)) {
+			// Not saved, to avoid wearing flash: `arm()` catches up from the stored start time after a restart
+			schedule->startTime += schedule->time;
+			arm(index);
+			return;
+		}
+		break;
+
+	case Type::absolute:
+	default:
+		break;
+	}
+
+	// Finished
+	if(schedule->autodelete) {
+		delete schedule;
+		schedules[index] = nullptr;
+	} else {
+		schedule->enabled = false;
+	}
+	save();
+	update();
+}
+
+void Schedules::tick()
+{
+	if(!SystemClock.isSet()) {
+		return;
+	}
+
+	uint32_t now = SystemClock.now(eTZ_Local);
+	if(!started) {
+		wheel.begin(now);
+		started = true;
+		for(unsigned i = 0; i < maxSchedules; ++i) {
+			arm(i);
+		}
+	}
+
+	wheel.advance(now, [this](unsigned index) { expired(index); });
+	update();
+}
+
+void Schedules::update()
+{
+	// Wheel is only driven whilst there's something to do
+	bool needed{false};
+	for(auto schedule : schedules) {
+		if(schedule != nullptr && schedule->enabled) {
+			needed = true;
+			break;
+		}
+	}
+
+	if(!needed) {
+		timer.stop();
+		// Wheel is rebuilt at the current time on restart
+		started = false;
+	} else if(!timer.isStarted()) {
+		timer.initializeMs<1000>([this]() { tick(); });
+		timer.start();
+	}
+}
+
+void Schedules::getInfo(const Schedule& schedule, JsonObject json) const
+{
+	json[FS_name] = schedule.name;
+	json[FS_description] = "";
+	RuleEngine::getActionInfo(schedule.command, json.createNestedObject(FS_command));
+	auto localtime = formatLocalTime(schedule);
+	json[FS_localtime] = localtime;
+	json[FS_time] = localtime;
+	json[FS_created] = formatTime(schedule.created);
+	json[FS_status] = schedule.enabled ? FS_enabled : FS_disabled;
+	if(schedule.type == Type::timer) {
+		json[FS_starttime] = formatTime(schedule.startTime);
+	}
+	if(schedule.type == Type::absolute || (schedule.type == Type::timer && !schedule.recurring)) {
+		json[FS_autodelete] = schedule.autodelete;
+	}
+}
+
+} // namespace Hue
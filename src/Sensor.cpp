@@ -0,0 +1,121 @@
+/**
+ * Sensor.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/Sensor.h"
+#include "include/Hue/Device.h"
+#include "Strings.h"
+#include <SystemClock.h>
+
+namespace Hue
+{
+namespace
+{
+#define XX(tag, type, modelid, cluster, stateKey) DEFINE_FSTR_LOCAL(cluster_##tag, cluster)
+HUE_SENSOR_TYPE_MAP(XX)
+#undef XX
+
+} // namespace
+
+String toString(Sensor::Type type)
+{
+	switch(type) {
+#define XX(tag, ...)                                                                                                   \
+	case Sensor::Type::tag:                                                                                            \
+		return F(#tag);
+		HUE_SENSOR_TYPE_MAP(XX)
+#undef XX
+	default:
+		return nullptr;
+	}
+}
+
+void Sensor::setValue(int32_t value)
+{
+	this->value = value;
+	lastUpdated = SystemClock.now(eTZ_UTC);
+	if(changeDelegate) {
+		changeDelegate(*this);
+	}
+}
+
+String Sensor::getUniqueId() const
+{
+	char buffer[Device::uniqueIdSize];
+	String s = Device::formatUniqueId(id, buffer);
+	s += '-';
+	switch(type) {
+#define XX(tag, ...)                                                                                                   \
+	case Type::tag:                                                                                                    \
+		s += cluster_##tag;                                                                                            \
+		break;
+		HUE_SENSOR_TYPE_MAP(XX)
+#undef XX
+	}
+	return s;
+}
+
+void Sensor::getInfo(JsonObject json)
+{
+	const FlashString* stateKey{nullptr};
+	switch(type) {
+#define XX(tag, typeName, modelid, cluster, key)                                                                       \
+	case Type::tag:                                                                                                    \
+		json[FS_type] = FS_##typeName;                                                                                 \
+		json[FS_modelid] = FS_##modelid;                                                                               \
+		stateKey = &FS_##key;                                                                                          \
+		break;
+		HUE_SENSOR_TYPE_MAP(XX)
+#undef XX
+	}
+
+	JsonObject state = json.createNestedObject(FS_state);
+	if(type == Type::presence) {
+		state[*stateKey] = (value != 0);
+	} else {
+		state[*stateKey] = value;
+	}
+
+	state[FS_lastupdated] = formatTime(lastUpdated);
+
+	JsonObject config = json.createNestedObject(FS_config);
+	config[FS_on] = true;
+	config[FS_reachable] = true;
+
+	json[FS_name] = name;
+	json[FS_manufacturername] = FS_Philips;
+	json[FS_swversion] = FS_VERSION;
+	json[FS_uniqueid] = getUniqueId();
+}
+
+/* Sensor::Enumerator */
+
+Sensor* Sensor::Enumerator::find(ID id)
+{
+	reset();
+	Sensor* sensor;
+	while((sensor = next()) != nullptr) {
+		if(*sensor == id) {
+			return sensor;
+		}
+	}
+
+	return nullptr;
+}
+
+} // namespace Hue
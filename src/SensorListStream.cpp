@@ -0,0 +1,65 @@
+/**
+ * SensorListStream.cpp - Support for streaming Hue sensor information in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "SensorListStream.h"
+
+namespace Hue
+{
+bool SensorListStream::getContent(String& content)
+{
+	switch(state) {
+	case State::start:
+		sensors->reset();
+		content = '{';
+		state = State::sensors;
+		return true;
+
+	case State::sensors: {
+		auto sensor = sensors->next();
+		if(sensor == nullptr) {
+			content = '}';
+			state = State::done;
+			return true;
+		}
+
+		StaticJsonDocument<2048> doc;
+		sensor->getInfo(doc.to<JsonObject>());
+		if(!first) {
+			content = ',';
+		}
+		first = false;
+		content += '"';
+		content += sensor->getId();
+		content += "\":";
+		content += Json::serialize(doc);
+		return true;
+	}
+
+	case State::done:
+	default:
+		return false;
+	}
+}
+
+String SensorListStream::getName() const
+{
+	return _F("sensors.json");
+}
+
+} // namespace Hue
@@ -0,0 +1,59 @@
+/****
+ * SensorListStream.h - Support for streaming Hue sensor information in JSON format
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "ChunkedStream.h"
+#include "include/Hue/Sensor.h"
+
+namespace Hue
+{
+/**
+ * @brief A forward-only stream for listing sensor information
+ * @note Sensor lists can be large so we only output one sensor at a time
+ */
+class SensorListStream : public ChunkedStream
+{
+public:
+	SensorListStream(Sensor::Enumerator* sensors) : sensors(sensors)
+	{
+	}
+
+	~SensorListStream()
+	{
+		delete sensors;
+	}
+
+	bool getContent(String& content) override;
+
+	String getName() const override;
+
+private:
+	enum class State {
+		start,
+		sensors,
+		done,
+	};
+
+	Sensor::Enumerator* sensors;
+	State state{State::start};
+	bool first{true};
+};
+
+} // namespace Hue
@@ -0,0 +1,99 @@
+/**
+ * SimulatedDevice.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/SimulatedDevice.h"
+#include <Platform/Timers.h>
+#include <Timer.h>
+#include <cmath>
+
+namespace Hue
+{
+uint32_t SimulatedLink::getJitter() const
+{
+	if(config.jitter == 0) {
+		return 0;
+	}
+
+	switch(config.distribution) {
+	case Distribution::exponential: {
+		// Inverse transform sampling, avoiding log(0)
+		auto u = (os_random() % 65535U + 1) / 65536.0f;
+		auto jitter = -logf(u) * config.jitter;
+		return std::min(uint32_t(jitter), uint32_t(config.jitter) * maxJitterFactor);
+	}
+	case Distribution::uniform:
+	default:
+		return os_random() % (config.jitter + 1U);
+	}
+}
+
+Status SimulatedLink::execute(Device& device, Device::Attribute attr, unsigned value, Device::Callback callback)
+{
+	++stats.count;
+
+	// Wait for link to become free
+	auto now = millis();
+	uint32_t delay{0};
+	if(config.maxRate != 0) {
+		if(int32_t(busyUntil - now) > 0) {
+			delay = busyUntil - now;
+		}
+		busyUntil = now + delay + 1000U / config.maxRate;
+	}
+
+	delay += config.latency + getJitter();
+
+	Status status{Status::success};
+	auto chance = os_random() % 100;
+	if(chance < config.lossPercent) {
+		++stats.lost;
+		delay = config.lossTimeout;
+		status = Status::error;
+	} else if(chance < unsigned(config.lossPercent + config.errorPercent)) {
+		++stats.failed;
+		status = Status::error;
+	}
+
+	delay = std::max(delay, 1U);
+	stats.maxDelay = std::max(stats.maxDelay, delay);
+
+	auto timer = new AutoDeleteTimer;
+	timer->initializeMs(delay, [&device, attr, value, callback, status]() {
+		auto result = status;
+		if(result == Status::success) {
+			// Wrapped device may itself complete asynchronously
+			result = device.setAttribute(attr, value, [callback](Status status, int errorCode) {
+				if(callback) {
+					callback(status, errorCode);
+				}
+			});
+			if(result == Status::pending) {
+				return;
+			}
+		}
+		if(callback) {
+			callback(result, 0);
+		}
+	});
+	timer->startOnce();
+
+	return Status::pending;
+}
+
+} // namespace Hue
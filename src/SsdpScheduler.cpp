@@ -0,0 +1,126 @@
+/**
+ * SsdpScheduler.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/SsdpScheduler.h"
+#include <Network/SSDP/Server.h>
+#include <Platform/Timers.h>
+
+namespace Hue
+{
+SsdpScheduler::Entry* SsdpScheduler::find(const SSDP::MessageSpec& ms)
+{
+	for(auto& e : entries) {
+		if(e.remotePort == ms.remotePort() && e.remoteIp == ms.remoteIp() && e.target == uint8_t(ms.target())) {
+			return &e;
+		}
+	}
+	return nullptr;
+}
+
+SsdpScheduler::Entry* SsdpScheduler::allocate(uint32_t now)
+{
+	// Use a free entry, or recycle the oldest one which isn't pending
+	Entry* oldest = nullptr;
+	for(auto& e : entries) {
+		if(e.remotePort == 0) {
+			return &e;
+		}
+		if(e.pending) {
+			continue;
+		}
+		if(oldest == nullptr || (now - e.timestamp) > (now - oldest->timestamp)) {
+			oldest = &e;
+		}
+	}
+
+	return oldest;
+}
+
+bool SsdpScheduler::takeToken(uint32_t now)
+{
+	uint32_t limit = config.maxRate * 1000U;
+	uint32_t elapsed = std::min(now - tokenTime, 1000U);
+	tokens = std::min(limit, tokens + elapsed * config.maxRate);
+	tokenTime = now;
+	if(tokens < 1000) {
+		return false;
+	}
+	tokens -= 1000;
+	return true;
+}
+
+void SsdpScheduler::defer(Entry& entry, const SSDP::MessageSpec& ms, uint32_t delay)
+{
+	auto spec = new SSDP::MessageSpec(ms);
+	entry.deferred = spec;
+	SSDP::server.messageQueue.add(spec, delay);
+}
+
+SsdpScheduler::Action SsdpScheduler::check(const SSDP::MessageSpec& ms)
+{
+	if(ms.type() != SSDP::MessageType::response) {
+		return Action::send;
+	}
+
+	auto now = millis();
+	auto entry = find(ms);
+
+	if(entry != nullptr && entry->pending && entry->deferred == &ms) {
+		// This is our deferred response coming back
+		entry->deferred = nullptr;
+		if(takeToken(now)) {
+			entry->pending = false;
+			entry->timestamp = now;
+			return Action::send;
+		}
+		// Give up if we've been throttled for too long
+		if(now - entry->timestamp > config.maxDelay + config.dedupWindow) {
+			entry->remotePort = 0;
+			entry->pending = false;
+			return Action::drop;
+		}
+		defer(*entry, ms, 1000U / std::max(config.maxRate, uint8_t(1)));
+		return Action::defer;
+	}
+
+	if(entry != nullptr) {
+		// Identical search whilst response pending, or recently sent
+		auto window = entry->pending ? config.maxDelay + config.dedupWindow : config.dedupWindow;
+		if(now - entry->timestamp < window) {
+			return Action::drop;
+		}
+	} else {
+		entry = allocate(now);
+		if(entry == nullptr) {
+			// Every entry has a response queued, so this one can't be tracked
+			return takeToken(now) ? Action::send : Action::drop;
+		}
+		entry->remoteIp = ms.remoteIp();
+		entry->remotePort = ms.remotePort();
+		entry->target = uint8_t(ms.target());
+	}
+
+	// MX is at least 1 second, so a `maxDelay` of up to 1000ms responds within it as the UPnP spec requires
+	entry->pending = true;
+	entry->timestamp = now;
+	defer(*entry, ms, (config.maxDelay == 0) ? 0 : os_random() % config.maxDelay);
+	return Action::defer;
+}
+
+} // namespace Hue
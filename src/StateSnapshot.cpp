@@ -0,0 +1,190 @@
+/**
+ * StateSnapshot.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/StateSnapshot.h"
+#include <FileSystem.h>
+#include <Platform/Timers.h>
+#include <algorithm>
+
+namespace Hue
+{
+uint32_t StateSnapshot::checksum(uint32_t hash, const void* data, size_t length)
+{
+	// FNV-1a
+	auto p = static_cast<const uint8_t*>(data);
+	while(length-- != 0) {
+		hash = (hash ^ *p++) * 16777619U;
+	}
+	return hash;
+}
+
+bool StateSnapshot::restore()
+{
+	file_t file = fileOpen(filename, eFO_ReadOnly);
+	if(file < 0) {
+		debug_i("[HUE] No state snapshot '%s'", filename.c_str());
+		return false;
+	}
+
+	Header header;
+	bool ok = fileRead(file, &header, sizeof(header)) == int(sizeof(header)) && header.magic == Header::magicValue &&
+			  header.recordSize == sizeof(Record);
+
+	Record records[chunkRecords];
+	auto readChunk = [&](unsigned index) -> unsigned {
+		auto count = std::min(unsigned(header.recordCount - index), unsigned(chunkRecords));
+		auto size = count * sizeof(Record);
+		return (fileRead(file, records, size) == int(size)) ? count : 0;
+	};
+
+	// Verify the whole file before applying any of it
+	uint32_t hash{checksumSeed};
+	for(unsigned i = 0; ok && i < header.recordCount;) {
+		auto count = readChunk(i);
+		hash = checksum(hash, records, count * sizeof(Record));
+		ok = (count != 0);
+		i += count;
+	}
+	ok = ok && hash == header.checksum && fileSeek(file, sizeof(header), eSO_FileStart) >= 0;
+
+	if(!ok) {
+		fileClose(file);
+		debug_w("[HUE] State snapshot '%s' invalid", filename.c_str());
+		return false;
+	}
+
+	// Devices may complete asynchronously and must always be given a callback
+	auto ignoreResult = [](Status, int) {};
+
+	for(unsigned i = 0; i < header.recordCount;) {
+		auto count = readChunk(i);
+		if(count == 0) {
+			break;
+		}
+		i += count;
+		for(unsigned r = 0; r < count; ++r) {
+			auto& rec = records[r];
+			auto device = devices->find(rec.id);
+			if(device == nullptr) {
+				continue;
+			}
+			for(unsigned a = 0; a < attributeCount; ++a) {
+				if(rec.mask & (1U << a)) {
+					device->setAttribute(Device::Attribute(a), rec.values[a], ignoreResult);
+				}
+			}
+		}
+	}
+	fileClose(file);
+
+	lastChecksum = header.checksum;
+	debug_i("[HUE] Restored %u device states", header.recordCount);
+	return true;
+}
+
+bool StateSnapshot::save()
+{
+	timer.stop();
+
+	// Records are built a chunk at a time so heap use doesn't grow with the number of devices
+	Record records[chunkRecords];
+	auto fillChunk = [&]() -> unsigned {
+		unsigned count{0};
+		Device* device;
+		while(count < chunkRecords && (device = devices->next()) != nullptr) {
+			auto& rec = records[count++];
+			memset(&rec, 0, sizeof(rec));
+			rec.id = device->getId();
+			for(unsigned a = 0; a < attributeCount; ++a) {
+				unsigned value;
+				if(device->getAttribute(Device::Attribute(a), value)) {
+					rec.mask |= 1U << a;
+					rec.values[a] = value;
+				}
+			}
+		}
+		return count;
+	};
+
+	// First pass computes checksum, so unchanged content isn't written
+	unsigned total{0};
+	uint32_t hash{checksumSeed};
+	devices->reset();
+	unsigned count;
+	while((count = fillChunk()) != 0) {
+		hash = checksum(hash, records, count * sizeof(Record));
+		total += count;
+	}
+
+	Header header{Header::magicValue, uint16_t(total), sizeof(Record), hash};
+	lastSaveTime = millis();
+	if(header.checksum == lastChecksum) {
+		debug_d("[HUE] State snapshot unchanged");
+		return true;
+	}
+
+	// Write to temporary file so a power failure doesn't lose the previous snapshot
+	String tmpName = filename + ".tmp";
+	file_t file = fileOpen(tmpName, eFO_CreateNewAlways | eFO_WriteOnly);
+	if(file < 0) {
+		debug_e("[HUE] Failed to create '%s'", tmpName.c_str());
+		return false;
+	}
+	bool ok = fileWrite(file, &header, sizeof(header)) == int(sizeof(header));
+	unsigned written{0};
+	devices->reset();
+	while(ok && written < total && (count = fillChunk()) != 0) {
+		count = std::min(count, total - written);
+		auto size = count * sizeof(Record);
+		ok = fileWrite(file, records, size) == int(size);
+		written += count;
+	}
+	ok = ok && written == total;
+	fileClose(file);
+	if(ok) {
+		fileDelete(filename);
+		ok = fileRename(tmpName.c_str(), filename.c_str()) >= 0;
+	}
+	if(!ok) {
+		debug_e("[HUE] Failed to write state snapshot");
+		fileDelete(tmpName);
+		return false;
+	}
+
+	lastChecksum = header.checksum;
+	debug_i("[HUE] Saved %u device states", total);
+	return true;
+}
+
+void StateSnapshot::changed()
+{
+	if(!isOpen() || timer.isStarted()) {
+		return;
+	}
+
+	auto delay = config.delay;
+	auto elapsed = millis() - lastSaveTime;
+	if(lastSaveTime != 0 && elapsed + delay < config.minInterval) {
+		delay = config.minInterval - elapsed;
+	}
+	timer.initializeMs(delay, [this]() { save(); });
+	timer.startOnce();
+}
+
+} // namespace Hue
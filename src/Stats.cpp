@@ -30,6 +30,8 @@ void Stats::serialize(JsonObject json) const
 	req[FS_getAllDev] = request.getAllDeviceInfo;
 	req[FS_getDev] = request.getDeviceInfo;
 	req[FS_setDev] = request.setDeviceInfo;
+	req[FS_getConfig] = request.getConfig;
+	req[FS_getDatastore] = request.getDatastore;
 	auto resp = json.createNestedObject(FS_resp);
 	resp[FS_count] = response.count;
 	resp[FS_size] = response.size;
@@ -38,6 +40,20 @@ void Stats::serialize(JsonObject json) const
 	err[FS_res] = error.resourceNotAvailable;
 	err[FS_meth] = error.methodNotAvailable;
 	err[FS_user] = error.unauthorizedUser;
+	err[FS_throttled] = error.throttled;
+	auto jssdp = json.createNestedObject(FS_ssdp);
+	jssdp[FS_count] = ssdp.count;
+	jssdp[FS_deferred] = ssdp.deferred;
+	jssdp[FS_dropped] = ssdp.dropped;
+	auto jslice = json.createNestedObject(FS_slice);
+	jslice[FS_count] = slice.count;
+	jslice[FS_yields] = slice.yields;
+	jslice[FS_maxTime] = slice.maxTime;
+	jslice[FS_totalTime] = slice.totalTime;
+	auto jrejected = json.createNestedObject(FS_rejected);
+#define XX(tag, maxInFlight, cost) jrejected[FS_##tag] = rejected[unsigned(AdmissionControl::Type::tag)];
+	HUE_ADMISSION_TYPE_MAP(XX)
+#undef XX
 }
 
 } // namespace Hue
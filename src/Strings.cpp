@@ -18,6 +18,7 @@
  ****/
 
 #include "Strings.h"
+#include <DateTime.h>
 
 namespace Hue
 {
@@ -29,4 +30,18 @@ HUE_STRING_MAP(XX)
 HUE_STRING_MAP2(XX)
 #undef XX
 
+String formatTime(time_t time)
+{
+	if(time == 0) {
+		return FS_none;
+	}
+
+	String s = DateTime(time).toISO8601();
+	// Hue omits the zone designator
+	if(s.endsWith("Z")) {
+		s.setLength(s.length() - 1);
+	}
+	return s;
+}
+
 } // namespace Hue
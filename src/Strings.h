@@ -19,6 +19,7 @@
 
 #pragma once
 #include <FlashString/String.hpp>
+#include <WString.h>
 
 #define HUE_STRING_MAP(XX)                                                                                             \
 	XX(req)                                                                                                            \
@@ -27,13 +28,64 @@
 	XX(getAllDev)                                                                                                      \
 	XX(getDev)                                                                                                         \
 	XX(setDev)                                                                                                         \
+	XX(getConfig)                                                                                                      \
+	XX(getDatastore)                                                                                                   \
 	XX(resp)                                                                                                           \
 	XX(size)                                                                                                           \
 	XX(err)                                                                                                            \
 	XX(res)                                                                                                            \
 	XX(meth)                                                                                                           \
+	XX(ssdp)                                                                                                           \
+	XX(deferred)                                                                                                       \
+	XX(dropped)                                                                                                        \
+	XX(slice)                                                                                                          \
+	XX(yields)                                                                                                         \
+	XX(maxTime)                                                                                                        \
+	XX(totalTime)                                                                                                      \
+	XX(rejected)                                                                                                       \
+	XX(list)                                                                                                           \
+	XX(datastore)                                                                                                      \
 	XX(users)                                                                                                          \
 	XX(user)                                                                                                           \
+	XX(throttled)                                                                                                      \
+	XX(failed)                                                                                                         \
+	XX(timeouts)                                                                                                       \
+	XX(devices)                                                                                                        \
+	XX(worst)                                                                                                          \
+	XX(avg)                                                                                                            \
+	XX(max)                                                                                                            \
+	XX(p50)                                                                                                            \
+	XX(p95)                                                                                                            \
+	XX(hist)                                                                                                           \
+	XX(stats)                                                                                                          \
+	XX(presence)                                                                                                       \
+	XX(temperature)                                                                                                    \
+	XX(buttonevent)                                                                                                    \
+	XX(lastupdated)                                                                                                    \
+	XX(on)                                                                                                             \
+	XX(ZLLPresence)                                                                                                    \
+	XX(ZLLTemperature)                                                                                                 \
+	XX(ZLLSwitch)                                                                                                      \
+	XX(SML001)                                                                                                         \
+	XX(RWL021)                                                                                                         \
+	XX(conditions)                                                                                                     \
+	XX(actions)                                                                                                        \
+	XX(operator)                                                                                                       \
+	XX(value)                                                                                                          \
+	XX(method)                                                                                                         \
+	XX(body)                                                                                                           \
+	XX(owner)                                                                                                          \
+	XX(created)                                                                                                        \
+	XX(lasttriggered)                                                                                                  \
+	XX(timestriggered)                                                                                                 \
+	XX(status)                                                                                                         \
+	XX(enabled)                                                                                                        \
+	XX(disabled)                                                                                                       \
+	XX(autodelete)                                                                                                     \
+	XX(command)                                                                                                        \
+	XX(starttime)                                                                                                      \
+	XX(time)                                                                                                           \
+	XX(id)                                                                                                             \
 	XX(devicetype)                                                                                                     \
 	XX(auth)                                                                                                           \
 	XX(address)                                                                                                        \
@@ -55,6 +107,27 @@
 	XX(state)                                                                                                          \
 	XX(swversion)                                                                                                      \
 	XX(type)                                                                                                           \
+	XX(apiversion)                                                                                                     \
+	XX(bridgeid)                                                                                                       \
+	XX(config)                                                                                                         \
+	XX(dhcp)                                                                                                           \
+	XX(gateway)                                                                                                        \
+	XX(groups)                                                                                                         \
+	XX(ipaddress)                                                                                                      \
+	XX(lights)                                                                                                         \
+	XX(linkbutton)                                                                                                     \
+	XX(localtime)                                                                                                      \
+	XX(mac)                                                                                                            \
+	XX(netmask)                                                                                                        \
+	XX(portalservices)                                                                                                 \
+	XX(resourcelinks)                                                                                                  \
+	XX(rules)                                                                                                          \
+	XX(scenes)                                                                                                         \
+	XX(schedules)                                                                                                      \
+	XX(sensors)                                                                                                        \
+	XX(whitelist)                                                                                                      \
+	XX(zigbeechannel)                                                                                                  \
+	XX(UTC)                                                                                                            \
 	XX(uniqueid)
 
 #define HUE_STRING_MAP2(XX)                                                                                            \
@@ -72,4 +145,11 @@ HUE_STRING_MAP(XX)
 HUE_STRING_MAP2(XX)
 #undef XX
 
+/**
+ * @brief Format a time as used in Hue responses, e.g. "2019-10-01T08:30:00"
+ * @param time UTC time, 0 if not set
+ * @retval String "none" if time is 0
+ */
+String formatTime(time_t time);
+
 } // namespace Hue
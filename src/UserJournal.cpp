@@ -0,0 +1,220 @@
+/**
+ * UserJournal.cpp
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#include "include/Hue/UserJournal.h"
+#include <FileSystem.h>
+
+namespace Hue
+{
+namespace
+{
+/*
+ * Record layout:
+ *
+ * 	Header
+ * 	name
+ * 	deviceType
+ * 	checksum (one byte)
+ */
+struct Header {
+	static constexpr uint8_t magicValue{0xA5};
+
+	uint8_t magic;
+	UserJournal::RecordType type;
+	uint8_t nameLength;
+	uint8_t deviceTypeLength;
+};
+
+uint8_t checksum(uint8_t sum, const void* data, size_t length)
+{
+	auto p = static_cast<const uint8_t*>(data);
+	while(length-- != 0) {
+		sum = (sum << 1 | sum >> 7) ^ *p++;
+	}
+	return sum;
+}
+
+bool writeRecord(file_t file, UserJournal::RecordType type, const String& name, const String& deviceType)
+{
+	auto nameLength = std::min(name.length(), size_t(UINT8_MAX));
+	auto deviceTypeLength = std::min(deviceType.length(), size_t(UINT8_MAX));
+	Header header{Header::magicValue, type, uint8_t(nameLength), uint8_t(deviceTypeLength)};
+
+	// Assemble record so it goes to flash in one write
+	char buffer[sizeof(header) + UINT8_MAX + UINT8_MAX + 1];
+	memcpy(buffer, &header, sizeof(header));
+	auto len = sizeof(header);
+	memcpy(&buffer[len], name.c_str(), nameLength);
+	len += nameLength;
+	memcpy(&buffer[len], deviceType.c_str(), deviceTypeLength);
+	len += deviceTypeLength;
+	buffer[len] = checksum(0, buffer, len);
+	++len;
+
+	return fileWrite(file, buffer, len) == int(len);
+}
+
+} // namespace
+
+bool UserJournal::replay(UserMap& users)
+{
+	recordCount = 0;
+	recover();
+	file_t file = fileOpen(filename, eFO_ReadOnly);
+	if(file < 0) {
+		debug_i("[HUE] No user journal '%s'", filename.c_str());
+		return true;
+	}
+
+	bool damaged{false};
+	for(;;) {
+		Header header;
+		int len = fileRead(file, &header, sizeof(header));
+		if(len == 0) {
+			break;
+		}
+		char data[UINT8_MAX + UINT8_MAX + 1];
+		auto dataLength = header.nameLength + header.deviceTypeLength;
+		if(len != int(sizeof(header)) || header.magic != Header::magicValue ||
+		   fileRead(file, data, dataLength + 1) != dataLength + 1) {
+			damaged = true;
+			break;
+		}
+		if(uint8_t(data[dataLength]) != checksum(checksum(0, &header, sizeof(header)), data, dataLength)) {
+			damaged = true;
+			break;
+		}
+
+		++recordCount;
+		String name(data, header.nameLength);
+		switch(header.type) {
+		case RecordType::authorize: {
+			auto& user = users[name];
+			user.deviceType.setString(&data[header.nameLength], header.deviceTypeLength);
+			user.authorized = true;
+			break;
+		}
+		case RecordType::revoke:
+			users.remove(name);
+			break;
+		default:
+			damaged = true;
+		}
+	}
+	fileClose(file);
+
+	debug_i("[HUE] Replayed %u user records from '%s'", recordCount, filename.c_str());
+
+	if(damaged) {
+		debug_w("[HUE] User journal damaged, compacting");
+		compact(users);
+		return false;
+	}
+
+	return true;
+}
+
+bool UserJournal::append(RecordType type, const String& name, const String& deviceType, const UserMap& users)
+{
+	unsigned authorizedCount{0};
+	for(unsigned i = 0; i < users.count(); ++i) {
+		if(users.valueAt(i).authorized) {
+			++authorizedCount;
+		}
+	}
+	if(recordCount >= authorizedCount + HUE_JOURNAL_COMPACT_THRESHOLD) {
+		// User list already reflects this change
+		return compact(users);
+	}
+
+	file_t file = fileOpen(filename, eFO_CreateIfNotExist | eFO_WriteOnly | eFO_Append);
+	if(file < 0) {
+		debug_e("[HUE] Failed to open user journal '%s'", filename.c_str());
+		return false;
+	}
+	bool ok = writeRecord(file, type, name, deviceType);
+	fileClose(file);
+	if(ok) {
+		++recordCount;
+	}
+	return ok;
+}
+
+void UserJournal::recover()
+{
+	String tmpName = getTempName();
+	if(!fileExist(tmpName)) {
+		return;
+	}
+
+	if(fileExist(filename)) {
+		// Interrupted whilst writing, journal is intact
+		debug_w("[HUE] Discarding incomplete '%s'", tmpName.c_str());
+		fileDelete(tmpName);
+		return;
+	}
+
+	// Interrupted between removing journal and renaming its replacement
+	debug_w("[HUE] Recovering user journal from '%s'", tmpName.c_str());
+	if(fileRename(tmpName.c_str(), filename.c_str()) < 0) {
+		debug_e("[HUE] User journal recovery failed");
+	}
+}
+
+bool UserJournal::compact(const UserMap& users)
+{
+	/*
+	 * Write to temporary file so journal isn't lost if interrupted.
+	 * The filesystem can't rename over an existing file, so there's a brief window
+	 * where only the temporary file exists; `recover()` handles that on next replay.
+	 */
+	String tmpName = getTempName();
+	file_t file = fileOpen(tmpName, eFO_CreateNewAlways | eFO_WriteOnly);
+	if(file < 0) {
+		debug_e("[HUE] Failed to create '%s'", tmpName.c_str());
+		return false;
+	}
+
+	unsigned count{0};
+	bool ok{true};
+	for(unsigned i = 0; ok && i < users.count(); ++i) {
+		auto& user = users.valueAt(i);
+		if(user.authorized) {
+			ok = writeRecord(file, RecordType::authorize, users.keyAt(i), user.deviceType);
+			++count;
+		}
+	}
+	fileClose(file);
+
+	if(ok) {
+		fileDelete(filename);
+		ok = fileRename(tmpName.c_str(), filename.c_str()) >= 0;
+	}
+	if(!ok) {
+		debug_e("[HUE] User journal compaction failed");
+		fileDelete(tmpName);
+		return false;
+	}
+
+	debug_i("[HUE] User journal compacted from %u to %u records", recordCount, count);
+	recordCount = count;
+	return true;
+}
+
+} // namespace Hue
@@ -0,0 +1,133 @@
+/****
+ * AdmissionControl.h - Limit concurrent responses according to available memory
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Response types subject to admission control
+ *
+ * XX(tag, maxInFlight, estimatedCost)
+ */
+#define HUE_ADMISSION_TYPE_MAP(XX)                                                                                     \
+	XX(list, 2, 1024)                                                                                                  \
+	XX(config, 2, 768)                                                                                                 \
+	XX(datastore, 1, 1280)                                                                                             \
+	XX(state, 4, 512)                                                                                                  \
+	XX(stats, 1, 512)
+
+namespace Hue
+{
+/**
+ * @brief Bounds the number of streamed responses alive at once
+ *
+ * Each response holds heap for its stream object, content buffer and possibly a cloned
+ * device enumerator. New responses are refused if the limit for their type has been reached,
+ * or if free heap would fall below a configured reserve.
+ */
+class AdmissionControl
+{
+public:
+	enum class Type {
+#define XX(tag, maxInFlight, cost) tag,
+		HUE_ADMISSION_TYPE_MAP(XX)
+#undef XX
+			MAX
+	};
+
+	static constexpr unsigned typeCount{unsigned(Type::MAX)};
+
+	struct Config {
+		uint8_t maxInFlight[typeCount];   ///< Maximum concurrent responses of each type
+		uint16_t estimatedCost[typeCount]; ///< Approximate heap used by each type of response
+		uint32_t minFreeHeap;			   ///< Heap to keep in reserve
+		/**
+		 * @brief How to refuse requests
+		 *
+		 * If true, respond with `503 Service Unavailable`.
+		 * Otherwise send a Hue error response (type 901, internal error 503).
+		 */
+		bool httpStatus;
+	};
+
+	/**
+	 * @brief Represents an admitted response, released on destruction
+	 */
+	class Ticket
+	{
+	public:
+		Ticket() = default;
+		Ticket(const Ticket&) = delete;
+		Ticket& operator=(const Ticket&) = delete;
+
+		Ticket& operator=(Ticket&& other)
+		{
+			release();
+			controller = other.controller;
+			type = other.type;
+			other.controller = nullptr;
+			return *this;
+		}
+
+		~Ticket()
+		{
+			release();
+		}
+
+		void release();
+
+	private:
+		friend class AdmissionControl;
+		AdmissionControl* controller{nullptr};
+		Type type{};
+	};
+
+	AdmissionControl();
+
+	void configure(const Config& config)
+	{
+		this->config = config;
+	}
+
+	const Config& getConfig() const
+	{
+		return config;
+	}
+
+	/**
+	 * @brief Request admission for a new response
+	 * @param type Type of response
+	 * @param ticket On success, holds the admission until released or destroyed
+	 * @retval bool false if the response should be refused
+	 */
+	bool admit(Type type, Ticket& ticket);
+
+	unsigned getInFlight(Type type) const
+	{
+		return inFlight[unsigned(type)];
+	}
+
+private:
+	Config config;
+	uint8_t inFlight[typeCount]{};
+};
+
+} // namespace Hue
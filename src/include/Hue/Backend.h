@@ -0,0 +1,149 @@
+/****
+ * Backend.h - Pipelined command queue for device links
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Device.h"
+
+/**
+ * @brief Number of commands which may be queued or in flight on a backend link
+ */
+#ifndef HUE_BACKEND_QUEUE_SIZE
+#define HUE_BACKEND_QUEUE_SIZE 16
+#endif
+
+namespace Hue
+{
+/**
+ * @brief Queues device commands for a shared link such as a serial bus
+ *
+ * Devices return the result of `submit()` from their `setAttribute()` implementation.
+ * Commands are passed to the transmit delegate in order, with up to `window` outstanding at once;
+ * the link reports each result by calling `complete()`.
+ *
+ * A queued command which has not yet been sent is superseded by a later command for the same device
+ * and attribute: the value is updated and both callbacks are invoked when it completes.
+ * If the queue is full, `submit()` fails immediately.
+ *
+ * The link may call `complete()` from within the transmit delegate. Callbacks for such commands
+ * are deferred via the task queue, since the device has not yet returned `pending` to its caller.
+ */
+class Backend
+{
+public:
+	struct Command {
+		Device::ID id;
+		Device::Attribute attr;
+		unsigned value;
+	};
+
+	/**
+	 * @brief Send a command on the link
+	 * @param command
+	 * @param tag Identifies the command; pass to `complete()`
+	 */
+	using TransmitDelegate = Delegate<void(const Command& command, uint8_t tag)>;
+
+	struct Config {
+		uint8_t window{4}; ///< Maximum commands in flight
+	};
+
+	struct Stats {
+		uint32_t submitted;
+		uint32_t coalesced; ///< Commands merged with one already queued
+		uint32_t rejected;  ///< Queue full
+	};
+
+	Backend(TransmitDelegate transmit) : transmit(transmit)
+	{
+	}
+
+	void configure(const Config& config)
+	{
+		this->config = config;
+		pump();
+	}
+
+	const Config& getConfig() const
+	{
+		return config;
+	}
+
+	/**
+	 * @brief Queue a command
+	 * @retval Status `pending` if queued, `error` if queue is full
+	 */
+	Status submit(Device::ID id, Device::Attribute attr, unsigned value, Device::Callback callback);
+
+	/**
+	 * @brief Called by the link when a command has completed
+	 * @param tag As passed to transmit delegate
+	 * @param status Result
+	 * @param errorCode Application-specific error code
+	 */
+	void complete(uint8_t tag, Status status, int errorCode);
+
+	unsigned getInFlight() const
+	{
+		return inFlight;
+	}
+
+	const Stats& getStats() const
+	{
+		return stats;
+	}
+
+private:
+	static constexpr unsigned queueSize{HUE_BACKEND_QUEUE_SIZE};
+	static constexpr uint8_t noSlot{0xff};
+
+	struct Slot {
+		enum class State : uint8_t {
+			free,
+			queued,
+			merged, ///< Holds callback for superseded command
+			inFlight,
+			completed, ///< Completed during transmit, callbacks deferred
+		};
+
+		Command command;
+		Device::Callback callback;
+		uint32_t sequence;
+		int errorCode;
+		Status status;
+		State state;
+		uint8_t chain; ///< Next merged slot
+	};
+
+	uint8_t allocate();
+	void pump();
+	void finish(uint8_t index, Status status, int errorCode);
+	void flush();
+
+	TransmitDelegate transmit;
+	Config config;
+	Slot slots[queueSize]{};
+	Stats stats{};
+	uint32_t sequence{0};
+	uint8_t inFlight{0};
+	bool transmitting{false};
+	bool flushQueued{false};
+};
+
+} // namespace Hue
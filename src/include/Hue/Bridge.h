@@ -20,32 +20,54 @@
 #pragma once
 
 #include "Device.h"
+#include "Sensor.h"
 #include "Stats.h"
+#include "SsdpScheduler.h"
+#include "RequestBody.h"
+#include "AdmissionControl.h"
+#include "User.h"
+#include "UserJournal.h"
+#include "StateSnapshot.h"
+#include "DeviceStats.h"
+#include "RetryPolicy.h"
+#include "EventQueue.h"
+#include "RuleEngine.h"
+#include "Schedules.h"
 #include <Network/HttpServer.h>
 #include <Data/WebConstants.h>
 #include <SimpleTimer.h>
+#include <Timer.h>
+#include <cassert>
+#include <memory>
 #include <Network/UPnP/schemas-upnp-org/ClassGroup.h>
 
-namespace Hue
-{
-enum class Model {
-	LWB004, ///< Dimmable white
-	LWB007, ///< Colour
-};
+/**
+ * @brief Number of devices for which state change notifications may be held back
+ */
+#ifndef HUE_NOTIFY_QUEUE_SIZE
+#define HUE_NOTIFY_QUEUE_SIZE 16
+#endif
 
 /**
- * @brief Information about user
+ * @brief Capacity of queue for externally driven state updates, must be a power of 2
  */
-struct User {
-	String deviceType;		///< How the user identifies themselves
-	uint16_t count{0};		///< Number of requests received from this user
-	bool authorized{false}; ///< Only authorized users may perform actions
-};
+#ifndef HUE_EVENT_QUEUE_SIZE
+#define HUE_EVENT_QUEUE_SIZE 32
+#endif
 
 /**
- * @brief List of users, key is user name
+ * @brief Default time budget for generating large responses
  */
-using UserMap = HashMap<String, User>;
+#ifndef HUE_SLICE_BUDGET_US
+#define HUE_SLICE_BUDGET_US 10000
+#endif
+
+namespace Hue
+{
+enum class Model {
+	LWB004, ///< Dimmable white
+	LWB007, ///< Colour
+};
 
 class Bridge : public UPnP::schemas_upnp_org::device::Basic1Template<Bridge>
 {
@@ -69,6 +91,8 @@ public:
 	 *
 	 * The application should use this to store new users in persistent memory.
 	 * At startup, these should be passed back via the `configure()` method.
+	 *
+	 * Alternatively, use `enableUserJournal()` and the bridge will take care of it.
 	 */
 	using ConfigDelegate = Delegate<void(const Config& config)>;
 
@@ -83,12 +107,41 @@ public:
 	 */
 	using StateChangeDelegate = Delegate<void(const Hue::Device& device, Hue::Device::Attributes attr)>;
 
+	/**
+	 * @brief Serial numbers for virtual bridges are derived from 6 bits of the first MAC octet
+	 */
+	static constexpr uint8_t maxInstances{64};
+
 	/**
 	 * @brief Constructor
 	 * @param devices List of devices to present
+	 * @param instance Identifies virtual bridges sharing one HTTP server, must be less than `maxInstances`.
+	 * Instance 0 responds to `/api`, others to `/bridge<instance>/api`.
+	 * Each instance has its own serial number and UDN.
 	 */
-	Bridge(Hue::Device::Enumerator& devices) : Basic1Template(), devices(devices)
+	Bridge(Hue::Device::Enumerator& devices, uint8_t instance = 0)
+		: Basic1Template(), devices(devices), instance(instance)
 	{
+		assert(instance < maxInstances);
+		pathPrefix = '/';
+		if(instance != 0) {
+			pathPrefix += F("bridge");
+			pathPrefix += instance;
+			pathPrefix += '/';
+		}
+	}
+
+	uint8_t getInstance() const
+	{
+		return instance;
+	}
+
+	/**
+	 * @brief Path prefix for all requests handled by this bridge, e.g. "/bridge1/"
+	 */
+	const String& getPathPrefix() const
+	{
+		return pathPrefix;
 	}
 
 	/**
@@ -110,6 +163,11 @@ public:
 		pairingEnabled = enable;
 	}
 
+	bool isPairingEnabled() const
+	{
+		return pairingEnabled;
+	}
+
 	void onConfigChange(ConfigDelegate delegate)
 	{
 		configDelegate = delegate;
@@ -120,8 +178,209 @@ public:
 		stateChangeDelegate = delegate;
 	}
 
+	/**
+	 * @brief Set sensors to present
+	 * @param sensors
+	 * @note Sensors added to the list later will not trigger rules until this is called again
+	 */
+	void setSensors(Sensor::Enumerator& sensors);
+
+	/**
+	 * @brief Get sensors
+	 * @retval Sensor::Enumerator* nullptr if none have been set
+	 */
+	Sensor::Enumerator* getSensors() const
+	{
+		return sensors;
+	}
+
+	/**
+	 * @brief Get devices
+	 */
+	Device::Enumerator& getDevices()
+	{
+		return devices;
+	}
+
+	/**
+	 * @brief Access rules created via `/api/<username>/rules`
+	 * @note The rule engine is allocated on first use
+	 */
+	RuleEngine& getRules()
+	{
+		if(!rules) {
+			rules.reset(new RuleEngine(*this));
+		}
+		return *rules;
+	}
+
+	/**
+	 * @brief Access schedules created via `/api/<username>/schedules`
+	 * @note The schedule table is allocated on first use
+	 */
+	Schedules& getSchedules()
+	{
+		if(!schedules) {
+			schedules.reset(new Schedules(*this));
+		}
+		return *schedules;
+	}
+
+	/**
+	 * @brief Store schedules in a file
+	 * @param filename
+	 *
+	 * Existing schedules are loaded, and subsequent changes saved. Call this once at startup,
+	 * after mounting the filesystem. Schedules start running once the system clock has been set.
+	 */
+	void enableScheduleStore(const String& filename)
+	{
+		getSchedules().open(filename);
+	}
+
+	/**
+	 * @brief Coalesce state change notifications
+	 * @param window Time in milliseconds; 0 to notify immediately (the default)
+	 *
+	 * Changes to a device within the window are merged and notified once, with the union
+	 * of changed attributes. This avoids excessive callbacks when, for example, a slider is dragged.
+	 * The queue of held-back changes is allocated only whilst a window is set.
+	 */
+	void setNotifyWindow(uint16_t window);
+
+	/**
+	 * @brief Deliver any held-back state change notifications immediately
+	 */
+	void flushStateChanges();
+
+	/**
+	 * @brief Report a change in device state which didn't come via the API
+	 * @param id Device ID
+	 * @param attr
+	 * @param value
+	 * @retval bool false if the event queue is full, or hasn't been enabled
+	 *
+	 * May be called from an interrupt handler, or from one other thread in a Host build.
+	 * Updates are applied in batches from the main task using `Device::applyState()`,
+	 * then notified as for API requests.
+	 *
+	 * @note Call `enableStateUpdates()` first
+	 */
+	bool postStateUpdate(Device::ID id, Device::Attribute attr, unsigned value);
+
+	/**
+	 * @brief Allocate the queue used by `postStateUpdate()`
+	 *
+	 * Call from the main task before posting any updates.
+	 */
+	void enableStateUpdates()
+	{
+		if(!events) {
+			events.reset(new EventQueue<StateUpdate, HUE_EVENT_QUEUE_SIZE>);
+		}
+	}
+
+	/**
+	 * @brief Get number of state updates lost because the event queue was full
+	 */
+	unsigned getDroppedStateUpdates() const
+	{
+		return events ? events->getDropped() : 0;
+	}
+
+	/**
+	 * @brief Call once the network is up to compute the bridge identity
+	 */
 	void begin();
 
+	/**
+	 * @brief Change how responses to SSDP searches are scheduled
+	 */
+	void configureSsdp(const SsdpScheduler::Config& config)
+	{
+		ssdpScheduler.configure(config);
+	}
+
+	/**
+	 * @brief Change per-user and per-address request rate limits
+	 */
+	void configureRateLimit(const RateLimiter::Config& config)
+	{
+		rateLimiter.configure(config);
+	}
+
+	/**
+	 * @brief Bridge identity, computed once per change of IP address
+	 */
+	struct Identity {
+		IpAddress ipaddr;		///< Address for which the identity was computed
+		String friendlyName;	///< "Philips hue (192.168.1.2)"
+		String serialNumber;	///< MAC address, lower-case hex without separators
+		String udn;				///< "uuid:2f402f80-da50-11e1-9b23-<serialNumber>"
+		String bridgeId;		///< MAC address with FFFE inserted in the middle, upper-case
+		String descriptionPath; ///< Where UPnP advertises description.xml
+		std::shared_ptr<const String> description; ///< Pre-rendered description.xml, shared with responses in flight
+		String etag;			///< Quoted hash of `description`
+	};
+
+	/**
+	 * @brief Get the bridge identity, updating it if the IP address has changed
+	 * @retval const Identity&
+	 */
+	const Identity& getIdentity() const;
+
+	/**
+	 * @brief Set time budget for generating large responses
+	 * @param budget Time in microseconds, 0 to disable slicing
+	 *
+	 * Light lists and the full datastore are generated in slices. When a slice exceeds
+	 * this budget the response yields so other connections and SSDP can be serviced.
+	 */
+	void setSliceBudget(uint32_t budget)
+	{
+		sliceBudget = budget;
+	}
+
+	/**
+	 * @brief Store users in a journal file
+	 * @param filename
+	 *
+	 * Existing records are replayed into the user list. Subsequent changes made via `configure()`
+	 * are appended to the journal. Call this once at startup, after mounting the filesystem.
+	 */
+	void enableUserJournal(const String& filename);
+
+	/**
+	 * @brief Persist device states in a snapshot file
+	 * @param filename
+	 *
+	 * Device states are restored from any existing snapshot, so call this at startup before `begin()`.
+	 * Thereafter changes are saved periodically; use `getStateSnapshot()` to adjust timing or force a save.
+	 */
+	void enableStateSnapshot(const String& filename)
+	{
+		snapshot.open(filename, devices);
+		snapshot.restore();
+	}
+
+	StateSnapshot& getStateSnapshot()
+	{
+		return snapshot;
+	}
+
+	/**
+	 * @brief Set limits for concurrent responses
+	 */
+	void configureAdmission(const AdmissionControl::Config& config)
+	{
+		admission.configure(config);
+	}
+
+	const AdmissionControl& getAdmission() const
+	{
+		return admission;
+	}
+
 	/**
 	 * @brief Get bridge statistics
 	 * @retval const Stats&
@@ -131,12 +390,36 @@ public:
 		return stats;
 	}
 
+	/**
+	 * @brief Get per-device statistics
+	 *
+	 * Also available via `GET /api/<username>/stats`.
+	 */
+	DeviceStats& getDeviceStats()
+	{
+		return deviceStats;
+	}
+
+	/**
+	 * @brief Change how pending device requests are timed out and retried
+	 */
+	void configureRetry(const RetryPolicy::Config& config)
+	{
+		retryPolicy.configure(config);
+	}
+
+	const RetryPolicy& getRetryPolicy() const
+	{
+		return retryPolicy;
+	}
+
 	/**
 	 * @brief Clear the bridge statistics
 	 */
 	void resetStats()
 	{
 		memset(&stats, 0, sizeof(stats));
+		deviceStats.reset();
 	}
 
 	/**
@@ -154,16 +437,18 @@ public:
 	 */
 	void getStatusInfo(JsonObject json);
 
+	/**
+	 * @brief Get bridge configuration as for `GET /api/<username>/config`
+	 * @param json Where to write information
+	 * @note Whitelist is not included, see `getUsers()`
+	 */
+	void getConfig(JsonObject json);
+
 	/**
 	 * @brief Devices call this method when their state has been updated
 	 * @note Applications should not call this method
 	 */
-	void deviceStateChanged(const Hue::Device& device, Hue::Device::Attributes changed)
-	{
-		if(stateChangeDelegate) {
-			stateChangeDelegate(device, changed);
-		}
-	}
+	void deviceStateChanged(const Hue::Device& device, Hue::Device::Attributes changed);
 
 	/* UPnP::Device */
 
@@ -173,17 +458,50 @@ public:
 	bool onHttpRequest(HttpServerConnection& connection) override;
 
 private:
-	void createUser(JsonObjectConst request, JsonDocument& result, const String& path);
-	bool validateUser(const char* userName);
+	void createUser(const RequestBody& request, JsonDocument& result);
+	User* validateUser(const char* userName);
 	void handleApiRequest(HttpServerConnection& connection);
+	void sendDescription(HttpServerConnection& connection);
+	void updateIdentity() const;
+	void notifyStateChange(const Hue::Device& device, Hue::Device::Attributes changed);
+	void processStateUpdates();
 
 private:
 	UserMap users;
 	bool pairingEnabled = false;
 	Hue::Device::Enumerator& devices;
+	Sensor::Enumerator* sensors{nullptr};
+	uint8_t instance;
+	String pathPrefix;
 	ConfigDelegate configDelegate;
 	StateChangeDelegate stateChangeDelegate;
+	struct PendingChange {
+		Device::ID id;
+		Device::Attributes changed;
+	};
+	std::unique_ptr<PendingChange[]> pendingChanges; ///< Allocated whilst notifyWindow is set
+	uint8_t pendingChangeCount{0};
+	uint16_t notifyWindow{0};
+	Timer notifyTimer;
+	struct StateUpdate {
+		Device::ID id;
+		Device::Attribute attr;
+		unsigned value;
+	};
+	std::unique_ptr<EventQueue<StateUpdate, HUE_EVENT_QUEUE_SIZE>> events;
+	std::atomic<bool> eventsScheduled{false};
 	Stats stats;
+	DeviceStats deviceStats{devices};
+	RetryPolicy retryPolicy;
+	SsdpScheduler ssdpScheduler;
+	AdmissionControl admission;
+	RateLimiter rateLimiter;
+	UserJournal journal;
+	StateSnapshot snapshot;
+	std::unique_ptr<RuleEngine> rules;
+	std::unique_ptr<Schedules> schedules;
+	uint32_t sliceBudget{HUE_SLICE_BUDGET_US};
+	mutable Identity identity;
 };
 
 } // namespace Hue
@@ -0,0 +1,88 @@
+/****
+ * BridgeGroup.h - Run several virtual bridges from one process
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Bridge.h"
+#include "ShardEnumerator.h"
+
+namespace Hue
+{
+/**
+ * @brief Manages a set of virtual bridges, each presenting a shard of one device list
+ *
+ * Controllers limit the number of lights per bridge. Splitting a large device set across
+ * several bridges gets around this whilst sharing one HTTP server and one set of backends.
+ *
+ * Each bridge has its own serial number and UDN. Bridge 0 responds to `/api`,
+ * the others to `/bridge<n>/api` and advertise this in their description URLBase.
+ */
+class BridgeGroup
+{
+public:
+	/**
+	 * @brief Constructor
+	 * @param devices The complete set of devices
+	 * @param count Number of bridges to create, at most `Bridge::maxInstances`
+	 * @param shardFunction Optionally determines which bridge presents a device.
+	 * If not provided, devices are allocated using `id % count`.
+	 */
+	BridgeGroup(Device::Enumerator& devices, uint8_t count, ShardEnumerator::ShardFunction shardFunction = nullptr);
+
+	~BridgeGroup();
+
+	/**
+	 * @brief Register all bridges with the UPnP device host and compute their identities
+	 */
+	void begin();
+
+	uint8_t count() const
+	{
+		return bridgeCount;
+	}
+
+	Bridge& operator[](unsigned index)
+	{
+		return *bridges[index];
+	}
+
+	/**
+	 * @brief Dispatch a request directly to the appropriate bridge
+	 * @retval bool true if request was handled
+	 *
+	 * The bridge is selected from the path prefix without consulting the other bridges.
+	 */
+	bool onHttpRequest(HttpServerConnection& connection);
+
+	/**
+	 * @brief Perform a configuration action on all bridges
+	 */
+	void configure(const Bridge::Config& config);
+
+	void enablePairing(bool enable);
+	void onConfigChange(Bridge::ConfigDelegate delegate);
+	void onStateChanged(Bridge::StateChangeDelegate delegate);
+
+private:
+	ShardEnumerator** shards;
+	Bridge** bridges;
+	uint8_t bridgeCount;
+};
+
+} // namespace Hue
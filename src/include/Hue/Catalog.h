@@ -0,0 +1,224 @@
+/****
+ * Catalog.h - Device definitions stored in flash
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Device.h"
+#include <FileSystem.h>
+
+/**
+ * @brief Default number of device objects kept in memory
+ */
+#ifndef HUE_CATALOG_CACHE_SIZE
+#define HUE_CATALOG_CACHE_SIZE 8
+#endif
+
+namespace Hue
+{
+class Catalog;
+
+/**
+ * @brief Device materialised from a catalog entry
+ *
+ * Supported attributes are given by the capability mask. State is held by the catalog,
+ * so it survives when the view is recycled.
+ */
+class CatalogDevice : public Device
+{
+public:
+	/**
+	 * @brief Compact device state
+	 */
+	struct State {
+		uint16_t hue;
+		uint16_t ct;
+		uint8_t bri;
+		uint8_t sat;
+		bool on;
+	};
+
+	ID getId() const override
+	{
+		return id;
+	}
+
+	String getName() const override
+	{
+		return name;
+	}
+
+	Attributes getCapabilities() const
+	{
+		return caps;
+	}
+
+	bool getAttribute(Attribute attr, unsigned& value) const override;
+	Status setAttribute(Attribute attr, unsigned value, Callback callback) override;
+	ColorMode getColorMode() const override;
+
+	bool applyState(Attribute attr, unsigned value) override
+	{
+		// State is only cached here, so never pends
+		return CatalogDevice::setAttribute(attr, value, nullptr) == Status::success;
+	}
+
+private:
+	friend class Catalog;
+
+	ID id{0};
+	String name;
+	Attributes caps;
+	State* state{nullptr};
+	int index{-1};		 ///< Catalog index, -1 if view unused
+	uint32_t lastUsed{0}; ///< For LRU replacement
+};
+
+/**
+ * @brief Device definitions read on demand from a catalog file
+ *
+ * The catalog is an array of fixed-size entries in ascending ID order, so any entry
+ * can be located with a seek and lookup by ID is a binary search. Only a small number of
+ * `CatalogDevice` objects exist at any time; they are recycled on a least-recently-used basis.
+ * As noted for `Device::Enumerator`, returned devices are only valid for the current task call.
+ *
+ * Device states are kept in RAM, about 8 bytes per device.
+ */
+class Catalog
+{
+public:
+	static constexpr unsigned maxNameLength{23};
+
+	/**
+	 * @brief Catalog file entry
+	 */
+	struct Entry {
+		Device::ID id;
+		uint8_t caps; ///< Device::Attributes
+		uint8_t reserved[3];
+		char name[maxNameLength + 1];
+	};
+
+	~Catalog()
+	{
+		close();
+	}
+
+	/**
+	 * @brief Add an entry to a catalog file
+	 * @param filename
+	 * @param id Must be greater than that of the last entry
+	 * @param caps Attributes supported by the device
+	 * @param name Truncated if longer than `maxNameLength`
+	 * @retval bool true on success
+	 */
+	static bool append(const String& filename, Device::ID id, Device::Attributes caps, const String& name);
+
+	/**
+	 * @brief Open a catalog
+	 * @param filename
+	 * @param cacheSize Number of devices to keep in memory
+	 * @retval bool true on success
+	 */
+	bool open(const String& filename, unsigned cacheSize = HUE_CATALOG_CACHE_SIZE);
+
+	void close();
+
+	/**
+	 * @brief Get number of devices in catalog
+	 */
+	unsigned count() const
+	{
+		return entryCount;
+	}
+
+	/**
+	 * @brief Get device by catalog index
+	 * @retval Device* nullptr if index is out of range or entry can't be read
+	 */
+	Device* get(unsigned index);
+
+	/**
+	 * @brief Find catalog index for a device
+	 * @retval int -1 if not found
+	 */
+	int indexOf(Device::ID id);
+
+private:
+	bool readEntry(unsigned index, Entry& entry);
+
+	file_t file{-1};
+	unsigned entryCount{0};
+	CatalogDevice::State* states{nullptr};
+	CatalogDevice* views{nullptr};
+	unsigned cacheSize{0};
+	uint32_t useCount{0};
+};
+
+/**
+ * @brief Enumerates all devices in a catalog
+ */
+class CatalogEnumerator : public Device::Enumerator
+{
+public:
+	CatalogEnumerator(Catalog& catalog) : catalog(catalog)
+	{
+	}
+
+	Device::Enumerator* clone() override
+	{
+		return new CatalogEnumerator(*this);
+	}
+
+	void reset() override
+	{
+		index = 0;
+	}
+
+	Device* current() override
+	{
+		return catalog.get(index);
+	}
+
+	Device* next() override
+	{
+		auto device = catalog.get(index);
+		if(device != nullptr) {
+			++index;
+		}
+		return device;
+	}
+
+	Device* find(Device::ID id) override
+	{
+		int i = catalog.indexOf(id);
+		if(i < 0) {
+			return nullptr;
+		}
+		index = i;
+		return catalog.get(index);
+	}
+
+	using Enumerator::find;
+
+private:
+	Catalog& catalog;
+	unsigned index{0};
+};
+
+} // namespace Hue
@@ -64,6 +64,11 @@ public:
 		}
 	}
 
+	bool applyState(Attribute attr, unsigned value) override
+	{
+		return ColourDevice::setAttribute(attr, value, nullptr) == Status::success;
+	}
+
 private:
 	uint8_t sat = 0;
 	uint16_t hue = 0;
@@ -25,13 +25,36 @@
 #include <ArduinoJson6.h>
 #include <Data/BitSet.h>
 
+/*
+ * Error descriptions contain placeholders for arguments.
+ * These are single control characters so responses can be written without searching for tags.
+ */
+#define HUE_ERROR_ARG_MAP(XX)                                                                                          \
+	XX(1, resource)                                                                                                    \
+	XX(2, method_name)                                                                                                 \
+	XX(3, parameter)                                                                                                   \
+	XX(4, error_code)                                                                                                  \
+	XX(5, value)
+
+#define HUE_ERROR_ARG_resource "\x01"
+#define HUE_ERROR_ARG_method_name "\x02"
+#define HUE_ERROR_ARG_parameter "\x03"
+#define HUE_ERROR_ARG_error_code "\x04"
+#define HUE_ERROR_ARG_value "\x05"
+
 #define HUE_ERROR_CODE_MAP(XX)                                                                                         \
 	XX(1, UnauthorizedUser, "unauthorized user")                                                                       \
-	XX(3, ResourceNotAvailable, "resource, <resource>, not available")                                                 \
-	XX(4, MethodNotAvailable, "method, <method_name>, not available for resource, <resource>")                         \
-	XX(6, ParameterNotAvailable, "parameter, <parameter>, not available")                                              \
+	XX(2, InvalidJson, "body contains invalid JSON")                                                                   \
+	XX(3, ResourceNotAvailable, "resource, " HUE_ERROR_ARG_resource ", not available")                                 \
+	XX(4, MethodNotAvailable,                                                                                          \
+	   "method, " HUE_ERROR_ARG_method_name ", not available for resource, " HUE_ERROR_ARG_resource)                   \
+	XX(5, MissingParameters, "invalid/missing parameters in body")                                                     \
+	XX(6, ParameterNotAvailable, "parameter, " HUE_ERROR_ARG_parameter ", not available")                              \
+	XX(7, InvalidValue, "invalid value, " HUE_ERROR_ARG_value ", for parameter, " HUE_ERROR_ARG_parameter)             \
 	XX(101, LinkButtonNotPressed, "link button not pressed")                                                           \
-	XX(901, InternalError, "Internal error, <error_code>")
+	XX(601, RuleEngineFull, "Rule engine full")                                                                        \
+	XX(701, ScheduleListFull, "Cannot create schedule because schedule list is full")                                  \
+	XX(901, InternalError, "Internal error, " HUE_ERROR_ARG_error_code)
 
 namespace Hue
 {
@@ -54,6 +77,12 @@ enum class Error {
 #undef XX
 };
 
+enum class ErrorArg {
+#define XX(code, tag) tag = code,
+	HUE_ERROR_ARG_MAP(XX)
+#undef XX
+};
+
 /**
  * @brief Status of a `setAttribute` request
  */
@@ -85,6 +114,10 @@ enum class Status {
 	error,
 };
 
+/**
+ * @brief Get error description
+ * @retval String Placeholders are shown as "<resource>", etc.
+ */
 String toString(Error error);
 JsonObject createSuccess(JsonDocument& result);
 JsonObject createError(JsonDocument& result, const String& path, Error error, String description);
@@ -166,17 +199,77 @@ public:
 	 */
 	virtual bool getAttribute(Attribute attr, unsigned& value) const = 0;
 
+	/**
+	 * @brief Update device state following an external change, such as a wall switch
+	 * @param attr
+	 * @param value
+	 * @retval bool true if the cached state was updated
+	 * @note The default implementation ignores the update and returns false.
+	 * Devices must override this to accept external changes, updating only their cached state:
+	 * the change has already happened, so nothing should be sent to hardware.
+	 */
+	virtual bool applyState(Attribute attr, unsigned value)
+	{
+		return false;
+	}
+
+	/**
+	 * @brief Determines how the device ID is combined with the MAC address to build a unique ID
+	 */
+	enum class UniqueIdScheme {
+		/**
+		 * @brief AA:BB:CC:DD:EE:FF:II:II-II
+		 *
+		 * Full 48-bit MAC address plus lower 24 bits of the device ID. This is the default.
+		 */
+		mac48id24,
+		/**
+		 * @brief BB:CC:DD:EE:FF:II:II:II-II
+		 *
+		 * Lower 40 bits of MAC address plus the full 32-bit device ID.
+		 * Use this where device IDs do not fit into 24 bits.
+		 */
+		mac40id32,
+	};
+
+	/**
+	 * @brief Size of buffer required for a unique ID string, including NUL terminator
+	 */
+	static constexpr size_t uniqueIdSize{27};
+
+	/**
+	 * @brief Select unique ID scheme for all devices
+	 * @note Changing the scheme changes all unique IDs so controllers will see new devices
+	 */
+	static void setUniqueIdScheme(UniqueIdScheme scheme)
+	{
+		uniqueIdScheme = scheme;
+	}
+
+	static UniqueIdScheme getUniqueIdScheme()
+	{
+		return uniqueIdScheme;
+	}
+
 	/**
 	 * @brief Returns the unique device ID string
 	 * @retval String Unique ID of the form AA:BB:CC:DD:EE:FF:00:11-XX,
 	 * consisting of a 64-bit Zigbee MAC address plus unique endpoint ID.
 	 * @note Other forms of ID string may be used, however for maximum
 	 * compatibility the standard format should be used.
-	 * By default, this method uses the WiFi station MAC address,
-	 * with 00:11 appended plus the 8-bit device ID.
+	 * By default, this method uses the WiFi station MAC address
+	 * with the device ID appended as determined by `UniqueIdScheme`.
 	 */
 	virtual String getUniqueId() const;
 
+	/**
+	 * @brief Format a standard unique ID without using the heap
+	 * @param id Device ID
+	 * @param buffer Receives NUL-terminated result
+	 * @retval char* Points to buffer
+	 */
+	static char* formatUniqueId(ID id, char (&buffer)[uniqueIdSize]);
+
 	virtual ColorMode getColorMode() const
 	{
 		return ColorMode::none;
@@ -201,6 +294,9 @@ public:
 	{
 		return getId() == id;
 	}
+
+private:
+	static UniqueIdScheme uniqueIdScheme;
 };
 
 String toString(Device::Attribute attr);
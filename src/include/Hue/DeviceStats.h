@@ -0,0 +1,130 @@
+/****
+ * DeviceStats.h - Per-device command latency and failure statistics
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Device.h"
+#include <memory>
+
+namespace Hue
+{
+/**
+ * @brief Tracks how each device responds to commands
+ *
+ * Each command is counted once, at its final outcome. Latency is measured from the first call
+ * to `setAttribute()` until completion, so includes any retries; average and maximum are kept.
+ * Response time is measured from the call to `setAttribute()` which produced the reply, so reflects
+ * the device alone. This is what `RetryPolicy` needs, so it is summarised in a histogram
+ * with power-of-two buckets: bucket 0 holds times under 8ms, bucket n holds [8 * 2^(n-1), 8 * 2^n) ms
+ * and the last bucket holds everything longer. When a bucket fills all counts are halved,
+ * so the histogram favours recent behaviour.
+ *
+ * The table holds one entry for every device, ordered by ID. It is sized from the device enumerator
+ * on first use, and rebuilt if a device appears which isn't in the table.
+ */
+class DeviceStats
+{
+public:
+	static constexpr unsigned bucketCount{10};
+	static constexpr unsigned firstBucketLimit{8}; ///< Upper bound of bucket 0, in ms
+	static constexpr unsigned summaryDevices{3};   ///< Devices listed in summary
+
+	DeviceStats(Device::Enumerator& devices) : devices(devices)
+	{
+	}
+
+	struct Entry {
+		Device::ID id;
+		uint16_t commands; ///< Calls to `setAttribute()`
+		uint16_t failures; ///< Commands completed with error status
+		uint16_t timeouts; ///< Pending commands abandoned
+		uint16_t maxLatency;
+		uint16_t maxResponseTime;
+		uint32_t totalLatency;			///< In milliseconds
+		uint8_t histogram[bucketCount]; ///< Response times
+
+		/**
+		 * @brief Estimate response time percentile from histogram
+		 * @param percent
+		 * @retval unsigned Upper bound of bucket containing the percentile, in ms
+		 */
+		unsigned percentile(unsigned percent) const;
+	};
+
+	/**
+	 * @brief Record command completion
+	 * @param id Device
+	 * @param status Result of command
+	 * @param latency Time taken, including retries, in milliseconds
+	 * @param responseTime Time taken by the attempt which completed, in milliseconds
+	 */
+	void record(Device::ID id, Status status, uint32_t latency, uint32_t responseTime);
+
+	/**
+	 * @brief Record a command which failed to complete in time
+	 */
+	void timeout(Device::ID id);
+
+	/**
+	 * @brief Find entry for a device
+	 * @retval const Entry* nullptr if no commands have been recorded
+	 */
+	const Entry* find(Device::ID id) const;
+
+	/**
+	 * @brief Get number of entries in the table
+	 */
+	unsigned getSize() const
+	{
+		return size;
+	}
+
+	/**
+	 * @brief Get entry by table index
+	 * @retval const Entry* nullptr if index is out of range or entry unused
+	 */
+	const Entry* getEntry(unsigned index) const
+	{
+		return (index < size && entries[index].commands != 0) ? &entries[index] : nullptr;
+	}
+
+	void serialize(const Entry& entry, JsonObject json) const;
+
+	/**
+	 * @brief Write totals for all devices plus those with most failures
+	 * @param json
+	 */
+	void serializeSummary(JsonObject json) const;
+
+	void reset()
+	{
+		entries.reset();
+		size = 0;
+	}
+
+private:
+	Entry* get(Device::ID id);
+	bool rebuild();
+
+	Device::Enumerator& devices;
+	std::unique_ptr<Entry[]> entries;
+	unsigned size{0};
+};
+
+} // namespace Hue
@@ -52,6 +52,11 @@ public:
 		}
 	}
 
+	bool applyState(Attribute attr, unsigned value) override
+	{
+		return DimmableDevice::setAttribute(attr, value, nullptr) == Status::success;
+	}
+
 private:
 	uint8_t bri{1};
 };
@@ -0,0 +1,171 @@
+/****
+ * Entertainment.h - UDP streaming of light colours
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Device.h"
+#include <Network/UdpConnection.h>
+
+/**
+ * @brief Default UDP port, as for the Hue Entertainment API
+ */
+#ifndef HUE_ENTERTAINMENT_PORT
+#define HUE_ENTERTAINMENT_PORT 2100
+#endif
+
+/**
+ * @brief Number of asynchronous devices which may have a streamed command outstanding
+ */
+#ifndef HUE_ENTERTAINMENT_MAX_BUSY
+#define HUE_ENTERTAINMENT_MAX_BUSY 10
+#endif
+
+namespace Hue
+{
+class Bridge;
+
+/**
+ * @brief Receives light colours streamed over UDP
+ *
+ * Frames use the Hue Entertainment API (HueStream version 1) layout, without DTLS:
+ *
+ * - 16-byte header: "HueStream", version 0x01 0x00, sequence number, 2 reserved bytes,
+ *   colour space (0 = RGB, 1 = XY + brightness), 1 reserved byte
+ * - 9 bytes per light: type (0 = light), 16-bit ID, three 16-bit values, all big-endian
+ *
+ * Frames are applied directly, without the HTTP request path. A frame whose sequence number is older
+ * than the last one accepted is dropped. Once streaming starts, frames from other addresses are
+ * ignored until the stream has been idle for `Config::idleTimeout`.
+ *
+ * By default RGB frames are converted to hue, saturation and brightness, and applied to devices via
+ * `Device::setAttribute()`. Set a frame callback to handle frames directly instead.
+ * Only attributes which differ from the cached state are sent. A device which returns `pending`
+ * is skipped by later frames until its command completes, so slow devices get the latest colour
+ * rather than a growing backlog. A command which never completes is given up after the deadline
+ * set by the bridge `RetryPolicy`, and all are forgotten when the stream ends.
+ *
+ * @note This is plaintext: use only on a trusted network.
+ */
+class Entertainment
+{
+public:
+	enum class ColourSpace : uint8_t {
+		rgb,
+		xy,
+	};
+
+	struct Light {
+		Device::ID id;
+		uint16_t values[3]; ///< R, G, B or X, Y, brightness
+	};
+
+	/**
+	 * @brief Frame information passed to callback
+	 * @note Lights are decoded on demand from the receive buffer, which is only valid during the callback
+	 */
+	struct Frame {
+		uint8_t sequence;
+		ColourSpace colourSpace;
+		uint16_t lightCount;
+		const uint8_t* data;
+
+		Light getLight(unsigned index) const;
+	};
+
+	using FrameDelegate = Delegate<void(const Frame& frame)>;
+
+	struct Config {
+		uint16_t idleTimeout{1000}; ///< Time in ms after which a new stream may start
+	};
+
+	struct Stats {
+		uint32_t frames;  ///< Frames applied
+		uint32_t lights;  ///< Light updates applied
+		uint32_t stale;	  ///< Frames dropped as out of sequence
+		uint32_t invalid; ///< Frames with bad header or length
+		uint32_t ignored; ///< Frames from another source whilst streaming
+		uint32_t busy;	///< Light updates skipped whilst device busy
+	};
+
+	Entertainment(Bridge& bridge) : bridge(bridge), udp(UdpConnectionDataDelegate(&Entertainment::receive, this))
+	{
+	}
+
+	/**
+	 * @brief Start listening for frames
+	 */
+	bool begin(uint16_t port = HUE_ENTERTAINMENT_PORT)
+	{
+		return udp.listen(port);
+	}
+
+	void end()
+	{
+		udp.close();
+		streaming = false;
+		busyCount = 0;
+	}
+
+	void configure(const Config& config)
+	{
+		this->config = config;
+	}
+
+	/**
+	 * @brief Set callback to handle frames, replacing default processing
+	 */
+	void onFrame(FrameDelegate delegate)
+	{
+		frameDelegate = delegate;
+	}
+
+	const Stats& getStats() const
+	{
+		return stats;
+	}
+
+	/**
+	 * @brief Apply a frame to devices (default handling)
+	 */
+	void apply(const Frame& frame);
+
+private:
+	void receive(UdpConnection& connection, char* data, int size, IpAddress remoteIP, uint16_t remotePort);
+	bool isBusy(Device::ID id) const;
+	void setBusy(Device::ID id, bool state);
+	void expireBusy();
+
+	Bridge& bridge;
+	UdpConnection udp;
+	Config config;
+	FrameDelegate frameDelegate;
+	Stats stats{};
+	IpAddress source;
+	uint32_t lastFrameTime{0};
+	struct Busy {
+		Device::ID id;
+		uint32_t deadline; ///< Time at which command is given up
+	};
+	Busy busy[HUE_ENTERTAINMENT_MAX_BUSY];
+	uint8_t busyCount{0};
+	uint8_t lastSequence{0};
+	bool streaming{false};
+};
+
+} // namespace Hue
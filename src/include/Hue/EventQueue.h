@@ -0,0 +1,91 @@
+/****
+ * EventQueue.h - Lock-free queue for passing events into the main task
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+namespace Hue
+{
+/**
+ * @brief Fixed-size single-producer, single-consumer queue
+ * @tparam T Item type, must be trivially copyable
+ * @tparam size Capacity, must be a power of 2
+ *
+ * One context (an interrupt handler or another thread) may call `push()` while another calls `pop()`,
+ * without locking. There must be only one of each.
+ */
+template <typename T, unsigned size> class EventQueue
+{
+public:
+	static_assert((size & (size - 1)) == 0, "EventQueue size must be a power of 2");
+
+	/**
+	 * @brief Add an item to the queue (producer)
+	 * @retval bool false if queue is full
+	 */
+	bool push(const T& item)
+	{
+		auto head = this->head.load(std::memory_order_relaxed);
+		if(head - tail.load(std::memory_order_acquire) >= size) {
+			++dropped;
+			return false;
+		}
+		items[head & (size - 1)] = item;
+		this->head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Take the oldest item from the queue (consumer)
+	 * @retval bool false if queue is empty
+	 */
+	bool pop(T& item)
+	{
+		auto tail = this->tail.load(std::memory_order_relaxed);
+		if(tail == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = items[tail & (size - 1)];
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool isEmpty() const
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief Number of items discarded because the queue was full
+	 */
+	unsigned getDropped() const
+	{
+		return dropped;
+	}
+
+private:
+	T items[size];
+	std::atomic<uint32_t> head{0}; ///< Written only by producer
+	std::atomic<uint32_t> tail{0}; ///< Written only by consumer
+	uint32_t dropped{0};		   ///< Written only by producer
+};
+
+} // namespace Hue
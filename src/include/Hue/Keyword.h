@@ -0,0 +1,89 @@
+/****
+ * Keyword.h - Constant-time lookup of Hue request keywords
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Device.h"
+
+namespace Hue
+{
+/*
+ * Keywords recognised in request bodies.
+ * Device attributes come first so an Attribute may be cast directly to a Keyword.
+ */
+#define HUE_KEYWORD_MAP(XX)                                                                                            \
+	HUE_DEVICE_ATTR_MAP(XX)                                                                                            \
+	XX(transitiontime)                                                                                                 \
+	XX(xy)                                                                                                             \
+	XX(alert)                                                                                                          \
+	XX(effect)                                                                                                         \
+	XX(scene)                                                                                                          \
+	XX(bri_inc)                                                                                                        \
+	XX(sat_inc)                                                                                                        \
+	XX(hue_inc)                                                                                                        \
+	XX(ct_inc)                                                                                                         \
+	XX(xy_inc)                                                                                                         \
+	XX(colormode)                                                                                                      \
+	XX(devicetype)                                                                                                     \
+	XX(username)                                                                                                       \
+	XX(name)
+
+enum class Keyword : uint8_t {
+#define XX(t) t,
+	HUE_KEYWORD_MAP(XX)
+#undef XX
+		MAX ///< Not a keyword
+};
+
+/**
+ * @brief Perfect hash over HUE_KEYWORD_MAP
+ *
+ * Coefficients were found by search. If keywords are added and two hash to the same value
+ * the compiler reports a duplicate case value in `fromString()`: adjust the coefficients to suit.
+ */
+constexpr uint8_t keywordHash(const char* s, size_t len)
+{
+	return ((len * 24) + (uint8_t(s[0]) * 19) + uint8_t(s[len - 1])) % 29;
+}
+
+/**
+ * @brief Get keyword text
+ * @retval const char* nullptr if keyword is invalid
+ */
+const char* getKeywordName(Keyword kw);
+
+/**
+ * @brief Look up a keyword
+ * @param tag Text to match, e.g. "transitiontime"
+ * @param kw On success, the keyword
+ * @retval bool true if tag is a keyword
+ */
+bool fromString(const char* tag, Keyword& kw);
+
+/**
+ * @brief Determine if a keyword corresponds to a device attribute
+ */
+inline bool isAttribute(Keyword kw)
+{
+#define XX(t) +1
+	return unsigned(kw) < (0 HUE_DEVICE_ATTR_MAP(XX));
+#undef XX
+}
+
+} // namespace Hue
@@ -62,6 +62,12 @@ public:
 		}
 	}
 
+	bool applyState(Attribute attr, unsigned value) override
+	{
+		// State is only cached here, so never pends
+		return OnOffDevice::setAttribute(attr, value, nullptr) == Status::success;
+	}
+
 private:
 	ID id;
 	String name;
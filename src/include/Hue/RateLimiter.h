@@ -0,0 +1,113 @@
+/****
+ * RateLimiter.h - Token bucket rate limiting for API clients
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <IpAddress.h>
+
+/**
+ * @brief Number of source addresses tracked for rate limiting
+ */
+#ifndef HUE_RATE_LIMIT_ADDRESSES
+#define HUE_RATE_LIMIT_ADDRESSES 16
+#endif
+
+namespace Hue
+{
+/**
+ * @brief Simple token bucket
+ *
+ * Tokens are held x 1000 so fractional refills aren't lost.
+ * A bucket which has never been used starts full.
+ */
+struct TokenBucket {
+	uint32_t tokens{0};
+	uint32_t timestamp{0}; ///< When last refilled, 0 if never used
+
+	/**
+	 * @brief Take one token from the bucket
+	 * @param now Current time in milliseconds
+	 * @param rate Refill rate in tokens per second
+	 * @param burst Capacity of the bucket
+	 * @retval bool false if bucket is empty
+	 */
+	bool take(uint32_t now, uint8_t rate, uint8_t burst);
+
+	/**
+	 * @brief Determine whether the bucket would be full by now, so forgetting it loses nothing
+	 */
+	bool isFull(uint32_t now, uint8_t rate, uint8_t burst) const;
+};
+
+/**
+ * @brief Throttles API requests per user and per source address
+ *
+ * A single app polling rapidly can hog the connection queue and delay requests from voice assistants.
+ * Each user carries its own bucket (see `User`), and a small table holds buckets for recent
+ * source addresses. Both checks are constant-time.
+ *
+ * An address entry is only reused once its bucket has refilled. If none can be reused then
+ * requests from new addresses are rejected, so rotating source addresses doesn't avoid the limit.
+ */
+class RateLimiter
+{
+public:
+	struct Config {
+		uint8_t userRate{10};	///< Requests per second for each user, 0 to disable
+		uint8_t userBurst{20};   ///< Requests a user may make in quick succession
+		uint8_t addressRate{20}; ///< Requests per second from each IP address, 0 to disable
+		uint8_t addressBurst{40};
+	};
+
+	void configure(const Config& config)
+	{
+		this->config = config;
+	}
+
+	const Config& getConfig() const
+	{
+		return config;
+	}
+
+	/**
+	 * @brief Check whether a request from the given address may proceed
+	 * @retval bool false if request should be rejected
+	 */
+	bool checkAddress(IpAddress address);
+
+	/**
+	 * @brief Check whether a request from a user may proceed
+	 * @param bucket The user's bucket
+	 * @retval bool false if request should be rejected
+	 */
+	bool checkUser(TokenBucket& bucket);
+
+private:
+	static constexpr unsigned maxAddresses{HUE_RATE_LIMIT_ADDRESSES};
+
+	struct Entry {
+		IpAddress address;
+		TokenBucket bucket;
+	};
+
+	Config config;
+	Entry entries[maxAddresses]{};
+};
+
+} // namespace Hue
@@ -0,0 +1,153 @@
+/****
+ * RequestBody.h - Incremental parser for Hue API request bodies
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <Network/Http/HttpRequest.h>
+#include "Keyword.h"
+
+/**
+ * @brief Number of request bodies which may be parsed concurrently
+ */
+#ifndef HUE_BODY_PARSER_SLOTS
+#define HUE_BODY_PARSER_SLOTS 4
+#endif
+
+/**
+ * @brief Maximum number of top-level parameters stored for a request
+ */
+#ifndef HUE_REQUEST_MAX_PARAMS
+#define HUE_REQUEST_MAX_PARAMS 8
+#endif
+
+namespace Hue
+{
+/**
+ * @brief Body parser for JSON requests
+ *
+ * Register with the HTTP server in place of `bodyToStringParser`:
+ *
+ * 		server.setBodyParser(MIME_JSON, Hue::bodyParser);
+ *
+ * Requests to the Hue API are parsed as data arrives, without buffering.
+ * Other requests are passed to `bodyToStringParser`.
+ */
+size_t bodyParser(HttpRequest& request, const char* at, int length);
+
+/**
+ * @brief Top-level content of a JSON object request body
+ *
+ * Scalar values for up to `maxParams` keys are retained. Strings are not stored,
+ * except for `devicetype` which is required to create users.
+ *
+ * This covers light state and user creation requests. Limitations:
+ *
+ * - Nested values, such as `xy` arrays, are recorded as present but their content is skipped
+ * - Keys longer than `maxKeyLength`, or more than `maxParams` keys, set `overflow`;
+ *   the bridge then rejects the request with a Hue `InvalidJson` error rather than apply part of it
+ *
+ * Rule and schedule definitions need their nested content, so are buffered and parsed with ArduinoJson instead.
+ */
+struct RequestBody {
+	static constexpr unsigned maxParams{HUE_REQUEST_MAX_PARAMS};
+	static constexpr unsigned maxKeyLength{15};
+	static constexpr unsigned maxDeviceTypeLength{40};
+
+	struct Param {
+		enum class Type : uint8_t {
+			boolean,
+			number,
+			string,
+			null,
+			nested, ///< Array or object
+		};
+
+		char key[maxKeyLength + 1];
+		Keyword keyword; ///< Keyword::MAX if not recognised
+		Type type;
+		int32_t value; ///< boolean or integer part of number
+	};
+
+	Param params[maxParams];
+	uint8_t paramCount;
+	bool overflow; ///< Too many parameters, or key too long
+	bool error;	///< Syntax error
+	char deviceType[maxDeviceTypeLength + 1];
+
+	/**
+	 * @brief Prepare for parsing a new body
+	 */
+	void begin();
+
+	/**
+	 * @brief Parse some data
+	 * @retval bool false on syntax error
+	 */
+	bool parse(const char* data, size_t length);
+
+	/**
+	 * @brief Parse end of data
+	 * @retval bool false if content was incomplete or invalid
+	 */
+	bool end();
+
+	/**
+	 * @brief Find the parsed body for a request
+	 * @retval RequestBody* nullptr if request has no parsed body
+	 */
+	static RequestBody* get(const HttpRequest& request);
+
+	/**
+	 * @brief Release parsed body for a request once it's been dealt with
+	 * @note The request releases it anyway when it completes or its connection closes
+	 */
+	static void release(const HttpRequest& request);
+
+private:
+	enum class State : uint8_t {
+		start,
+		key,
+		keyChars,
+		colon,
+		value,
+		string,
+		literal,
+		number,
+		nested,
+		nestedString,
+		next,
+		done,
+	};
+
+	bool parseChar(char c);
+	void setValue(Param::Type type, int32_t value);
+
+	State state;
+	bool escape;
+	bool captureText;
+	bool negative;
+	bool fraction;
+	uint8_t keyLength;
+	uint8_t textLength;
+	uint8_t depth;
+	char literal[6];
+	int32_t number;
+};
+
+} // namespace Hue
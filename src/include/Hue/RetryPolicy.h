@@ -0,0 +1,101 @@
+/****
+ * RetryPolicy.h - Deadlines and retries for pending device requests
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "DeviceStats.h"
+
+/**
+ * @brief Maximum time allowed to complete a request, including retries, in milliseconds
+ */
+#ifndef HUE_REQUEST_TIMEOUT_MS
+#define HUE_REQUEST_TIMEOUT_MS 5000
+#endif
+
+namespace Hue
+{
+/**
+ * @brief Determines how long to wait for pending device requests, and when to retry
+ *
+ * The deadline for each attempt is derived from the device's observed response times:
+ * a high percentile of past response times multiplied by a safety factor, clamped to configured limits.
+ * Response times are per attempt, so slow retries don't inflate later deadlines.
+ * Devices without history get `initialTimeout`. Retries back off exponentially.
+ * Everything must complete within `totalTimeout` so clients get a timely answer.
+ */
+class RetryPolicy
+{
+public:
+	struct Config {
+		uint16_t minTimeout{100};					 ///< Lower bound for attempt deadline, in ms
+		uint16_t maxTimeout{2000};					 ///< Upper bound for attempt deadline, in ms
+		uint16_t initialTimeout{1000};				 ///< Deadline for devices with no history, in ms
+		uint16_t totalTimeout{HUE_REQUEST_TIMEOUT_MS}; ///< Overall limit for request, in ms
+		uint16_t backoff{50};						 ///< Delay before first retry, in ms
+		uint16_t maxBackoff{800};					 ///< Upper bound for retry delay, in ms
+		uint8_t percentile{95};						 ///< Response time percentile used for deadline
+		uint8_t factor{3};							 ///< Deadline multiplier
+		uint8_t maxRetries{2};
+	};
+
+	void configure(const Config& config)
+	{
+		this->config = config;
+	}
+
+	const Config& getConfig() const
+	{
+		return config;
+	}
+
+	/**
+	 * @brief Get deadline for a single attempt
+	 * @param stats Device statistics, nullptr if none
+	 * @retval uint32_t Time in milliseconds
+	 */
+	uint32_t getTimeout(const DeviceStats::Entry* stats) const;
+
+	/**
+	 * @brief Get delay before retrying
+	 * @param attempt Number of attempts made so far, starting at 1
+	 * @retval uint32_t Time in milliseconds
+	 */
+	uint32_t getBackoff(unsigned attempt) const
+	{
+		auto shift = std::min(attempt - 1, 15U);
+		return std::min(uint32_t(config.backoff) << shift, uint32_t(config.maxBackoff));
+	}
+
+	/**
+	 * @brief Determine whether another attempt should be made
+	 * @param attempt Number of attempts made so far
+	 * @param elapsed Time since request started, in ms
+	 * @param stats Device statistics, nullptr if none
+	 */
+	bool canRetry(unsigned attempt, uint32_t elapsed, const DeviceStats::Entry* stats) const
+	{
+		return attempt <= config.maxRetries &&
+			   elapsed + getBackoff(attempt) + getTimeout(stats) <= config.totalTimeout;
+	}
+
+private:
+	Config config;
+};
+
+} // namespace Hue
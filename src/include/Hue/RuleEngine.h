@@ -0,0 +1,232 @@
+/****
+ * RuleEngine.h - Bridge-resident rules triggered by state changes
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Device.h"
+#include "Sensor.h"
+
+/**
+ * @brief Maximum number of rules
+ */
+#ifndef HUE_MAX_RULES
+#define HUE_MAX_RULES 16
+#endif
+
+/**
+ * @brief Maximum number of conditions per rule
+ */
+#ifndef HUE_RULE_MAX_CONDITIONS
+#define HUE_RULE_MAX_CONDITIONS 4
+#endif
+
+/**
+ * @brief Maximum number of actions per rule
+ */
+#ifndef HUE_RULE_MAX_ACTIONS
+#define HUE_RULE_MAX_ACTIONS 4
+#endif
+
+#define HUE_RULE_OPERATOR_MAP(XX)                                                                                      \
+	XX(eq)                                                                                                             \
+	XX(gt)                                                                                                             \
+	XX(lt)                                                                                                             \
+	XX(dx)
+
+namespace Hue
+{
+class Bridge;
+
+/**
+ * @brief Evaluates rules created via `/api/<username>/rules`
+ *
+ * Rules are compiled from JSON into fixed-size structures. Conditions may test light attributes,
+ * `/lights/<id>/state/<attribute>`, or sensor state, `/sensors/<id>/state/<key>`.
+ * Actions set light state, `/lights/<id>/state`.
+ *
+ * An index of watched (source, id, key) entries is kept in sorted order. When a light or sensor changes,
+ * only rules with a matching entry are evaluated. A rule triggers when all of its conditions hold.
+ *
+ * Changes made by rule actions do not themselves trigger rules, avoiding loops.
+ * This includes actions on devices which complete asynchronously.
+ */
+class RuleEngine
+{
+public:
+	static constexpr unsigned maxRules{HUE_MAX_RULES};
+	static constexpr unsigned maxConditions{HUE_RULE_MAX_CONDITIONS};
+	static constexpr unsigned maxActions{HUE_RULE_MAX_ACTIONS};
+
+	static_assert(maxRules <= 32, "Too many rules");
+
+	struct Condition {
+		enum class Source : uint8_t {
+			light,
+			sensor,
+		};
+
+		enum class Operator : uint8_t {
+#define XX(tag) tag,
+			HUE_RULE_OPERATOR_MAP(XX)
+#undef XX
+		};
+
+		Source source;
+		Operator op;
+		uint8_t key; ///< Device::Attribute for lights, sensor key index for sensors
+		uint32_t id;
+		int32_t value;
+	};
+
+	struct Action {
+		static constexpr unsigned attributeCount{0
+#define XX(t) +1
+												 HUE_DEVICE_ATTR_MAP(XX)
+#undef XX
+		};
+
+		Device::ID id;
+		Device::Attributes attributes; ///< Attributes to set
+		uint16_t values[attributeCount];
+	};
+
+	struct Rule {
+		uint8_t id;
+		bool enabled;
+		uint8_t conditionCount;
+		uint8_t actionCount;
+		uint16_t timesTriggered;
+		time_t created;
+		time_t lastTriggered;
+		String name;
+		String owner;
+		Condition conditions[maxConditions];
+		Action actions[maxActions];
+	};
+
+	RuleEngine(Bridge& bridge) : bridge(bridge)
+	{
+	}
+
+	~RuleEngine();
+
+	/**
+	 * @brief Create a rule
+	 * @param json Rule definition as for `POST /api/<username>/rules`
+	 * @param owner User creating the rule
+	 * @param id On success, the new rule ID
+	 * @param error On failure, the error code
+	 * @param parameter On failure, the offending parameter
+	 * @param value On failure, the offending value
+	 * @retval bool true on success
+	 */
+	bool create(JsonObjectConst json, const String& owner, unsigned& id, Error& error, String& parameter,
+				String& value);
+
+	/**
+	 * @brief Delete a rule
+	 * @retval bool false if rule not found
+	 */
+	bool remove(unsigned id);
+
+	/**
+	 * @brief Find a rule by ID
+	 */
+	const Rule* find(unsigned id) const;
+
+	/**
+	 * @brief Get rule by table index, for enumeration
+	 * @retval const Rule* nullptr if slot is empty
+	 */
+	const Rule* getRule(unsigned index) const
+	{
+		return (index < maxRules) ? rules[index] : nullptr;
+	}
+
+	/**
+	 * @brief Get rule information as for `GET /api/<username>/rules/<id>`
+	 */
+	void getInfo(const Rule& rule, JsonObject json) const;
+
+	/**
+	 * @brief Parse an action of the form `{"address":"/lights/<id>/state","method":"PUT","body":{...}}`
+	 * @param json
+	 * @param action On success, the parsed action
+	 * @param parameter On failure, the offending parameter
+	 * @param value On failure, the offending value
+	 * @retval bool true on success
+	 * @note An `/api/<username>` prefix on the address, as used by schedules, is accepted
+	 */
+	static bool parseAction(JsonObjectConst json, Action& action, String& parameter, JsonVariantConst& value);
+
+	/**
+	 * @brief Output action information
+	 */
+	static void getActionInfo(const Action& action, JsonObject json);
+
+	/**
+	 * @brief Apply an action to its device and notify the change
+	 */
+	void execute(const Action& action);
+
+	/**
+	 * @brief Called when light attributes have changed
+	 */
+	void lightChanged(Device::ID id, Device::Attributes changed);
+
+	/**
+	 * @brief Called when a sensor has been updated
+	 */
+	void sensorChanged(const Sensor& sensor);
+
+	/**
+	 * @brief Determine whether rule actions are currently being applied
+	 */
+	bool isDispatching() const
+	{
+		return dispatching;
+	}
+
+private:
+	struct Watch {
+		uint32_t id;
+		Condition::Source source;
+		uint8_t key;
+		uint8_t rule; ///< Index into rules table
+	};
+
+	struct Event {
+		Condition::Source source;
+		uint32_t id;
+		uint32_t keys; ///< Bitmask of changed keys
+	};
+
+	void buildIndex();
+	void processEvent(const Event& event);
+	bool evaluate(const Condition& cond, const Event& event);
+	void trigger(Rule& rule);
+
+	Bridge& bridge;
+	Rule* rules[maxRules]{};
+	Watch watches[maxRules * maxConditions];
+	uint8_t watchCount{0};
+	bool dispatching{false};
+};
+
+} // namespace Hue
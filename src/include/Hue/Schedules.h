@@ -0,0 +1,165 @@
+/****
+ * Schedules.h - Timed actions as for `/api/<username>/schedules`
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "RuleEngine.h"
+#include "TimerWheel.h"
+#include <Timer.h>
+
+/**
+ * @brief Maximum number of schedules
+ */
+#ifndef HUE_MAX_SCHEDULES
+#define HUE_MAX_SCHEDULES 64
+#endif
+
+namespace Hue
+{
+class Bridge;
+
+/**
+ * @brief Manages schedules created via `/api/<username>/schedules`
+ *
+ * The following `localtime` formats are supported:
+ *
+ * - `YYYY-MM-DDThh:mm:ss` Absolute time
+ * - `W<bbb>/Thh:mm:ss` Weekly, where bbb is a bitmask of days: 64 = Monday ... 1 = Sunday
+ * - `PThh:mm:ss` Timer
+ * - `R[nn]/PThh:mm:ss` Recurring timer, nn times or indefinitely
+ *
+ * All schedules share one timer wheel driven by a single one-second `Timer`, which runs only
+ * while schedules exist. Nothing is armed until the system clock has been set.
+ *
+ * Schedules are stored as fixed-size records so they may be written directly to file.
+ * The file is written when schedules are created, deleted or finish, but not on each trigger
+ * of a recurring timer: on restart, periods elapsed since the stored start time count as triggered.
+ */
+class Schedules
+{
+public:
+	static constexpr unsigned maxSchedules{HUE_MAX_SCHEDULES};
+
+	static_assert(maxSchedules <= 255, "Too many schedules");
+
+	struct Schedule {
+		enum class Type : uint8_t {
+			absolute,
+			weekly,
+			timer,
+		};
+
+		uint8_t id;
+		Type type;
+		bool enabled;
+		bool autodelete;
+		uint8_t weekdays;	///< Weekly: days on which to trigger
+		uint8_t repeat;		 ///< Recurring timer: number of times to trigger, 0 for indefinitely
+		uint8_t remaining;   ///< Recurring timer: triggers remaining
+		bool recurring;		 ///< Timer restarts on expiry
+		uint32_t time;		 ///< Absolute: local time; Weekly: seconds since midnight; Timer: duration in seconds
+		uint32_t startTime;  ///< Timer: local time at which timer was last started
+		uint32_t created;	///< UTC
+		RuleEngine::Action command;
+		char name[32];
+	};
+
+	Schedules(Bridge& bridge) : bridge(bridge)
+	{
+	}
+
+	~Schedules();
+
+	/**
+	 * @brief Load schedules from file and save subsequent changes there
+	 * @param filename
+	 */
+	void open(const String& filename);
+
+	/**
+	 * @brief Create a schedule
+	 * @param json Schedule definition as for `POST /api/<username>/schedules`
+	 * @param id On success, the new schedule ID
+	 * @param error On failure, the error code
+	 * @param parameter On failure, the offending parameter
+	 * @param value On failure, the offending value
+	 * @retval bool true on success
+	 */
+	bool create(JsonObjectConst json, unsigned& id, Error& error, String& parameter, String& value);
+
+	/**
+	 * @brief Delete a schedule
+	 * @retval bool false if schedule not found
+	 */
+	bool remove(unsigned id);
+
+	/**
+	 * @brief Find a schedule by ID
+	 */
+	const Schedule* find(unsigned id) const
+	{
+		return (id == 0 || id > maxSchedules) ? nullptr : schedules[id - 1];
+	}
+
+	/**
+	 * @brief Get schedule by table index, for enumeration
+	 * @retval const Schedule* nullptr if slot is empty
+	 */
+	const Schedule* getSchedule(unsigned index) const
+	{
+		return (index < maxSchedules) ? schedules[index] : nullptr;
+	}
+
+	/**
+	 * @brief Get schedule information as for `GET /api/<username>/schedules/<id>`
+	 */
+	void getInfo(const Schedule& schedule, JsonObject json) const;
+
+	/**
+	 * @brief Get number of schedules currently armed
+	 */
+	unsigned getActiveCount() const
+	{
+		return wheel.getCount();
+	}
+
+private:
+	void arm(unsigned index);
+	void expired(unsigned index);
+	void tick();
+	void update();
+	bool save();
+
+	struct Header {
+		static constexpr uint32_t magicValue{0x31535548}; // "HUS1"
+
+		uint32_t magic;
+		uint16_t recordCount;
+		uint16_t recordSize;
+	};
+
+	Bridge& bridge;
+	String filename;
+	Schedule* schedules[maxSchedules]{};
+	TimerWheel<maxSchedules> wheel;
+	Timer timer;
+	bool started{false};
+};
+
+} // namespace Hue
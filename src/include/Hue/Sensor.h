@@ -0,0 +1,208 @@
+/****
+ * Sensor.h - Base class for emulated Hue sensors
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <WString.h>
+#include <ArduinoJson6.h>
+#include <DateTime.h>
+#include <Delegate.h>
+
+/*
+ * Supported sensor types
+ *
+ * XX(tag, type, modelid, cluster, stateKey)
+ */
+#define HUE_SENSOR_TYPE_MAP(XX)                                                                                        \
+	XX(presence, ZLLPresence, SML001, "02-0406", presence)                                                             \
+	XX(temperature, ZLLTemperature, SML001, "02-0402", temperature)                                                    \
+	XX(button, ZLLSwitch, RWL021, "02-fc00", buttonevent)
+
+namespace Hue
+{
+/**
+ * @brief A sensor presented by the bridge via `/api/<username>/sensors`
+ *
+ * Each sensor has a single state value, whose meaning depends on the type:
+ *
+ * - presence: 0 or 1
+ * - temperature: hundredths of a degree Celsius
+ * - button: Hue button event code, e.g. 1002 for button 1 short release
+ *
+ * Applications update the value as readings arrive. The time of the last update is tracked
+ * and reported as `lastupdated`.
+ */
+class Sensor
+{
+public:
+	using ID = uint32_t;
+
+	enum class Type {
+#define XX(tag, ...) tag,
+		HUE_SENSOR_TYPE_MAP(XX)
+#undef XX
+	};
+
+	/**
+	 * @brief Abstract class to manage a list of sensors
+	 * @note As for devices, returned sensor objects are only valid for the current task call.
+	 */
+	class Enumerator
+	{
+	public:
+		virtual ~Enumerator()
+		{
+		}
+
+		virtual Enumerator* clone() = 0;
+		virtual void reset() = 0;
+		virtual Sensor* current() = 0;
+		virtual Sensor* next() = 0;
+
+		/**
+		 * @brief Lookup sensor by ID
+		 * @retval Sensor* nullptr if not found
+		 */
+		virtual Sensor* find(ID id);
+	};
+
+	/**
+	 * @brief Invoked whenever the sensor value is updated
+	 */
+	using ChangeDelegate = Delegate<void(Sensor& sensor)>;
+
+	Sensor(ID id, Type type, const String& name) : id(id), type(type), name(name)
+	{
+	}
+
+	/**
+	 * @brief Set callback for sensor updates
+	 * @note This is set by the bridge when sensors are assigned to it
+	 */
+	void onChange(ChangeDelegate delegate)
+	{
+		changeDelegate = delegate;
+	}
+
+	virtual ~Sensor()
+	{
+	}
+
+	ID getId() const
+	{
+		return id;
+	}
+
+	Type getType() const
+	{
+		return type;
+	}
+
+	String getName() const
+	{
+		return name;
+	}
+
+	int32_t getValue() const
+	{
+		return value;
+	}
+
+	/**
+	 * @brief Set a new state value
+	 * @note lastupdated is changed even if the value is the same, as for a real sensor
+	 */
+	void setValue(int32_t value);
+
+	/**
+	 * @brief Get time of last update
+	 * @retval time_t 0 if never updated
+	 */
+	time_t getLastUpdated() const
+	{
+		return lastUpdated;
+	}
+
+	virtual String getUniqueId() const;
+
+	virtual void getInfo(JsonObject json);
+
+	bool operator==(ID id) const
+	{
+		return this->id == id;
+	}
+
+private:
+	ID id;
+	Type type;
+	String name;
+	int32_t value{0};
+	time_t lastUpdated{0};
+	ChangeDelegate changeDelegate;
+};
+
+String toString(Sensor::Type type);
+
+class PresenceSensor : public Sensor
+{
+public:
+	PresenceSensor(ID id, const String& name) : Sensor(id, Type::presence, name)
+	{
+	}
+
+	void setPresence(bool presence)
+	{
+		setValue(presence);
+	}
+};
+
+class TemperatureSensor : public Sensor
+{
+public:
+	TemperatureSensor(ID id, const String& name) : Sensor(id, Type::temperature, name)
+	{
+	}
+
+	/**
+	 * @param temperature In hundredths of a degree Celsius
+	 */
+	void setTemperature(int32_t temperature)
+	{
+		setValue(temperature);
+	}
+};
+
+class SwitchSensor : public Sensor
+{
+public:
+	SwitchSensor(ID id, const String& name) : Sensor(id, Type::button, name)
+	{
+	}
+
+	/**
+	 * @param event Hue button event code: button number x 1000 + action
+	 * (0 = initial press, 1 = hold, 2 = short release, 3 = long release)
+	 */
+	void setButtonEvent(unsigned event)
+	{
+		setValue(event);
+	}
+};
+
+} // namespace Hue
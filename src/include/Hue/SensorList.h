@@ -0,0 +1,61 @@
+/****
+ * SensorList.h - Simple list of sensors
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Sensor.h"
+#include <WVector.h>
+
+namespace Hue
+{
+using SensorList = Vector<Sensor>;
+
+class SensorListEnumerator : public Sensor::Enumerator
+{
+public:
+	SensorListEnumerator(SensorList& list) : list(list)
+	{
+	}
+
+	Sensor::Enumerator* clone() override
+	{
+		return new SensorListEnumerator(*this);
+	}
+
+	void reset() override
+	{
+		index = 0;
+	}
+
+	Sensor* current() override
+	{
+		return (size_t(index) < list.count()) ? &list[index] : nullptr;
+	}
+
+	Sensor* next() override
+	{
+		return (size_t(index) < list.count()) ? &list[index++] : nullptr;
+	}
+
+private:
+	SensorList& list;
+	int index{-1};
+};
+
+} // namespace Hue
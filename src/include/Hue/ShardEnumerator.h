@@ -0,0 +1,102 @@
+/****
+ * ShardEnumerator.h - Present a subset of devices from another enumerator
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Device.h"
+
+namespace Hue
+{
+/**
+ * @brief Enumerates only those devices from a source enumerator belonging to one shard
+ *
+ * By default devices are allocated to shards using `id % count`.
+ */
+class ShardEnumerator : public Device::Enumerator
+{
+public:
+	/**
+	 * @brief Return the shard index for a given device ID
+	 */
+	using ShardFunction = Delegate<uint8_t(Device::ID id)>;
+
+	ShardEnumerator(Device::Enumerator& source, uint8_t index, uint8_t count, ShardFunction shardFunction = nullptr)
+		: source(source), shardFunction(shardFunction), index(index), count(count)
+	{
+	}
+
+	~ShardEnumerator()
+	{
+		if(owned) {
+			delete &source;
+		}
+	}
+
+	Device::Enumerator* clone() override
+	{
+		auto e = new ShardEnumerator(*source.clone(), index, count, shardFunction);
+		e->owned = true;
+		return e;
+	}
+
+	void reset() override
+	{
+		source.reset();
+	}
+
+	Device* current() override
+	{
+		// Source may be positioned on a device from another shard, e.g. after `find()`
+		auto device = source.current();
+		return (device != nullptr && contains(device->getId())) ? device : nullptr;
+	}
+
+	Device* next() override
+	{
+		Device* device;
+		while((device = source.next()) != nullptr) {
+			if(contains(device->getId())) {
+				break;
+			}
+		}
+		return device;
+	}
+
+	Device* find(Device::ID id) override
+	{
+		return contains(id) ? source.find(id) : nullptr;
+	}
+
+	/**
+	 * @brief Determine whether a device ID belongs to this shard
+	 */
+	bool contains(Device::ID id) const
+	{
+		return (shardFunction ? shardFunction(id) : id % count) == index;
+	}
+
+private:
+	Device::Enumerator& source;
+	ShardFunction shardFunction;
+	uint8_t index;
+	uint8_t count;
+	bool owned{false};
+};
+
+} // namespace Hue
@@ -0,0 +1,150 @@
+/****
+ * SimulatedDevice.h - Emulate a slow or unreliable device link for testing
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Device.h"
+#include <memory>
+
+namespace Hue
+{
+/**
+ * @brief Simulates a shared link to real devices
+ *
+ * Each command is delayed by the link latency plus random jitter. Jitter is either uniform, or exponential
+ * with `jitter` as its mean, giving the long tail seen on real links. Commands are serialised
+ * so no more than `maxRate` start per second, further delaying commands when the link is busy.
+ * A percentage of commands can be lost, completing with an error after `lossTimeout`,
+ * or fail outright.
+ */
+class SimulatedLink
+{
+public:
+	enum class Distribution : uint8_t {
+		uniform,	 ///< Jitter between 0 and `jitter`
+		exponential, ///< Mean of `jitter`, up to `maxJitterFactor` times that
+	};
+
+	static constexpr unsigned maxJitterFactor{10};
+
+	struct Config {
+		uint16_t latency{50};	  ///< Base delay in ms
+		uint16_t jitter{50};	   ///< Additional random delay in ms, see `Distribution`
+		Distribution distribution{Distribution::uniform};
+		uint16_t maxRate{20};	  ///< Commands per second, 0 for no limit
+		uint8_t lossPercent{0};	///< Commands which get no response
+		uint8_t errorPercent{0};   ///< Commands which fail
+		uint16_t lossTimeout{2000}; ///< Time before a lost command is reported as failed
+	};
+
+	struct Stats {
+		uint32_t count;
+		uint32_t lost;
+		uint32_t failed;
+		uint32_t maxDelay; ///< Longest delay, in ms
+	};
+
+	void configure(const Config& config)
+	{
+		this->config = config;
+	}
+
+	const Config& getConfig() const
+	{
+		return config;
+	}
+
+	const Stats& getStats() const
+	{
+		return stats;
+	}
+
+	/**
+	 * @brief Schedule a command which applies an attribute value to a device
+	 * @retval Status Always `pending`
+	 */
+	Status execute(Device& device, Device::Attribute attr, unsigned value, Device::Callback callback);
+
+private:
+	uint32_t getJitter() const;
+
+	Config config;
+	Stats stats{};
+	uint32_t busyUntil{0}; ///< When link can accept the next command
+};
+
+/**
+ * @brief Wraps any device so attribute changes go via a `SimulatedLink`
+ *
+ * Use this to observe how the bridge behaves with realistic backend delays,
+ * for example in a Host build without hardware attached.
+ */
+class SimulatedDevice : public Device
+{
+public:
+	/**
+	 * @brief Constructor
+	 * @param device The device to wrap, ownership is taken
+	 * @param link
+	 */
+	SimulatedDevice(Device* device, SimulatedLink& link) : device(device), link(link)
+	{
+	}
+
+	ID getId() const override
+	{
+		return device->getId();
+	}
+
+	String getName() const override
+	{
+		return device->getName();
+	}
+
+	bool getAttribute(Attribute attr, unsigned& value) const override
+	{
+		return device->getAttribute(attr, value);
+	}
+
+	Status setAttribute(Attribute attr, unsigned value, Callback callback) override
+	{
+		return link.execute(*device, attr, value, callback);
+	}
+
+	bool applyState(Attribute attr, unsigned value) override
+	{
+		return device->applyState(attr, value);
+	}
+
+	String getUniqueId() const override
+	{
+		return device->getUniqueId();
+	}
+
+	ColorMode getColorMode() const override
+	{
+		return device->getColorMode();
+	}
+
+private:
+	std::unique_ptr<Device> device;
+	SimulatedLink& link;
+};
+
+} // namespace Hue
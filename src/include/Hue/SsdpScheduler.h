@@ -0,0 +1,106 @@
+/****
+ * SsdpScheduler.h - Jitter, de-duplicate and rate-limit SSDP search responses
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <Network/SSDP/MessageSpec.h>
+
+/**
+ * @brief Number of search responses tracked at once
+ *
+ * An `ssdp:all` search produces a response for each of several targets, so allow for a few
+ * searchers at once.
+ */
+#ifndef HUE_SSDP_SCHEDULER_ENTRIES
+#define HUE_SSDP_SCHEDULER_ENTRIES 32
+#endif
+
+namespace Hue
+{
+/**
+ * @brief Controls when responses to M-SEARCH requests are sent
+ *
+ * Several Echo devices and phone apps searching at once can generate a flood of identical requests.
+ * Each new search response is first deferred by a random delay, as required by the UPnP spec.
+ * Identical searches (same remote address, port and target) arriving while a response is pending,
+ * or within `dedupWindow` after it was sent, are dropped. Outgoing responses are capped using a
+ * token bucket; responses which exceed the rate are deferred again.
+ *
+ * Deferred responses are queued by the scheduler itself. Each entry records the queued copy so that
+ * when it comes back it can be distinguished from a new, identical search. If every entry has a
+ * response queued, further responses are sent immediately if the rate allows, otherwise dropped.
+ *
+ * NOTIFY messages are not affected.
+ */
+class SsdpScheduler
+{
+public:
+	struct Config {
+		uint16_t maxDelay{1000};	///< Upper bound for response jitter in ms. Keep within the minimum MX of 1 second.
+		uint16_t dedupWindow{2000}; ///< Identical searches within this period (ms) are answered once
+		uint8_t maxRate{20};		///< Maximum responses per second
+	};
+
+	enum class Action {
+		send,  ///< Send the message now
+		defer, ///< A copy of the message has been queued, discard this one
+		drop,  ///< Discard the message
+	};
+
+	void configure(const Config& config)
+	{
+		this->config = config;
+	}
+
+	const Config& getConfig() const
+	{
+		return config;
+	}
+
+	/**
+	 * @brief Decide what to do with an outgoing message
+	 * @param ms The message
+	 * @retval Action
+	 */
+	Action check(const SSDP::MessageSpec& ms);
+
+private:
+	static constexpr unsigned maxEntries{HUE_SSDP_SCHEDULER_ENTRIES};
+
+	struct Entry {
+		IpAddress remoteIp;
+		uint16_t remotePort;
+		uint8_t target;
+		bool pending;
+		uint32_t timestamp;					///< When scheduled or sent
+		const SSDP::MessageSpec* deferred; ///< Copy we queued, identifies it when it comes back
+	};
+
+	Entry* find(const SSDP::MessageSpec& ms);
+	Entry* allocate(uint32_t now);
+	bool takeToken(uint32_t now);
+	void defer(Entry& entry, const SSDP::MessageSpec& ms, uint32_t delay);
+
+	Config config;
+	Entry entries[maxEntries]{};
+	uint32_t tokenTime{0};
+	uint32_t tokens{0}; ///< Available tokens x 1000
+};
+
+} // namespace Hue
@@ -0,0 +1,125 @@
+/****
+ * StateSnapshot.h - Persist device states across restarts
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "Device.h"
+#include <Timer.h>
+
+namespace Hue
+{
+/**
+ * @brief Saves device attribute values to flash and restores them at startup
+ *
+ * Devices are written as fixed-size records, a few at a time so memory use doesn't depend
+ * on the number of devices. Changes are coalesced:
+ * the snapshot is written `delay` ms after the first change, but no more often than `minInterval`.
+ * If the content is unchanged since the last save or restore, nothing is written.
+ *
+ * Values are read and written via `Device::getAttribute` and `Device::setAttribute`,
+ * so custom device types are supported without change.
+ */
+class StateSnapshot
+{
+public:
+	struct Config {
+		uint32_t delay{5000};		///< Time from first change to writing snapshot, in ms
+		uint32_t minInterval{60000}; ///< Minimum time between writes, in ms
+	};
+
+	void configure(const Config& config)
+	{
+		this->config = config;
+	}
+
+	const Config& getConfig() const
+	{
+		return config;
+	}
+
+	/**
+	 * @brief Set file and devices to use
+	 * @param filename
+	 * @param devices
+	 */
+	void open(const String& filename, Device::Enumerator& devices)
+	{
+		this->filename = filename;
+		this->devices = &devices;
+	}
+
+	bool isOpen() const
+	{
+		return devices != nullptr;
+	}
+
+	/**
+	 * @brief Read snapshot and apply to devices
+	 * @retval bool true on success
+	 */
+	bool restore();
+
+	/**
+	 * @brief Write snapshot immediately, if anything has changed
+	 * @retval bool true on success
+	 */
+	bool save();
+
+	/**
+	 * @brief Called when device state has changed to schedule a save
+	 */
+	void changed();
+
+private:
+	static constexpr unsigned attributeCount{0
+#define XX(t) +1
+											 HUE_DEVICE_ATTR_MAP(XX)
+#undef XX
+	};
+
+	struct Header {
+		static constexpr uint32_t magicValue{0x31455548}; // "HUE1"
+
+		uint32_t magic;
+		uint16_t recordCount;
+		uint16_t recordSize;
+		uint32_t checksum;
+	};
+
+	struct Record {
+		Device::ID id;
+		uint8_t mask; ///< Attributes present
+		uint8_t reserved;
+		uint16_t values[attributeCount];
+	};
+
+	static constexpr unsigned chunkRecords{8};
+	static constexpr uint32_t checksumSeed{2166136261U};
+
+	static uint32_t checksum(uint32_t hash, const void* data, size_t length);
+
+	String filename;
+	Device::Enumerator* devices{nullptr};
+	Config config;
+	Timer timer;
+	uint32_t lastSaveTime{0};
+	uint32_t lastChecksum{0};
+};
+
+} // namespace Hue
@@ -21,9 +21,20 @@
 
 #include <stdint.h>
 #include <ArduinoJson6.h>
+#include "AdmissionControl.h"
 
 namespace Hue
 {
+/**
+ * @brief Metrics for time-sliced generation of large responses
+ */
+struct SliceStats {
+	uint16_t count;		///< Number of slices
+	uint16_t yields;	///< Slices which ended by yielding to the scheduler
+	uint32_t maxTime;   ///< Longest slice, in microseconds
+	uint32_t totalTime; ///< Total time spent generating content, in microseconds
+};
+
 struct Stats {
 	struct {
 		uint16_t count;   ///< Total number of HTTP requests
@@ -32,6 +43,8 @@ struct Stats {
 		uint16_t getAllDeviceInfo;
 		uint16_t getDeviceInfo;
 		uint16_t setDeviceInfo;
+		uint16_t getConfig;
+		uint16_t getDatastore;
 	} request;
 	struct {
 		uint16_t count;
@@ -42,7 +55,15 @@ struct Stats {
 		uint16_t resourceNotAvailable;
 		uint16_t methodNotAvailable;
 		uint16_t unauthorizedUser;
+		uint16_t throttled; ///< Requests rejected by rate limiting
 	} error;
+	struct {
+		uint16_t count;	///< SSDP messages sent
+		uint16_t deferred; ///< Search responses queued for later
+		uint16_t dropped;  ///< Duplicate or throttled search responses discarded
+	} ssdp;
+	SliceStats slice;
+	uint16_t rejected[AdmissionControl::typeCount]; ///< Responses refused by admission control
 
 	void serialize(JsonObject json) const;
 };
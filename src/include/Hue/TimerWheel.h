@@ -0,0 +1,246 @@
+/****
+ * TimerWheel.h - Hierarchical timer wheel
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace Hue
+{
+/**
+ * @brief Fixed-size hierarchical timer wheel with one second resolution
+ * @tparam size Number of timers, each identified by an index
+ *
+ * Each level has 64 slots. Level 0 covers the next 64 seconds, level 1 the next 64 * 64 seconds, and so on.
+ * Adding or removing a timer is O(1). As time advances, entries in higher levels are cascaded down
+ * into lower ones, and those in the current level 0 slot are expired.
+ *
+ * Timers beyond the range of the wheel (about 194 days) are parked in the top level and re-examined
+ * each time it rotates.
+ *
+ * Times are in seconds and may use any epoch, provided `advance()` is called with the same one.
+ */
+template <unsigned size> class TimerWheel
+{
+public:
+	static constexpr unsigned levelBits{6};
+	static constexpr unsigned slotCount{1U << levelBits};
+	static constexpr unsigned levels{4};
+	static constexpr uint16_t none{0xffff};
+
+	static_assert(size < none, "TimerWheel too large");
+
+	/**
+	 * @brief Reset the wheel to the given time, discarding all timers
+	 */
+	void begin(uint32_t now)
+	{
+		for(auto& head : heads) {
+			head = none;
+		}
+		for(auto& node : nodes) {
+			node.active = false;
+		}
+		current = now;
+		count = 0;
+	}
+
+	uint32_t getTime() const
+	{
+		return current;
+	}
+
+	/**
+	 * @brief Number of active timers
+	 */
+	unsigned getCount() const
+	{
+		return count;
+	}
+
+	bool isActive(unsigned index) const
+	{
+		return nodes[index].active;
+	}
+
+	uint32_t getExpiry(unsigned index) const
+	{
+		return nodes[index].expires;
+	}
+
+	/**
+	 * @brief Start a timer, replacing any existing one for this index
+	 * @param index
+	 * @param expires Time at which timer expires, no earlier than the next tick
+	 */
+	void add(unsigned index, uint32_t expires)
+	{
+		remove(index);
+		if(int32_t(expires - current) <= 0) {
+			expires = current + 1;
+		}
+		auto& node = nodes[index];
+		node.expires = expires;
+		node.active = true;
+		++count;
+		link(index);
+	}
+
+	/**
+	 * @brief Stop a timer
+	 */
+	void remove(unsigned index)
+	{
+		auto& node = nodes[index];
+		if(!node.active) {
+			return;
+		}
+		unlink(index);
+		node.active = false;
+		--count;
+	}
+
+	/**
+	 * @brief Bring the wheel up to date, invoking callback for expired timers
+	 * @param now Current time
+	 * @param callback Invoked as `callback(index)`, may add or remove timers
+	 *
+	 * If time has gone backwards, or jumped forward by more than a day, the wheel is rebuilt
+	 * rather than stepped through.
+	 */
+	template <typename Callback> void advance(uint32_t now, Callback callback)
+	{
+		auto diff = int32_t(now - current);
+		if(diff < 0 || diff > 86400) {
+			rebase(now, callback);
+			return;
+		}
+		while(current != now) {
+			++current;
+			// Cascade higher levels when lower ones wrap
+			for(unsigned level = levels - 1; level > 0; --level) {
+				auto shift = level * levelBits;
+				if((current & ((1U << shift) - 1)) == 0) {
+					cascade(level * slotCount + ((current >> shift) & (slotCount - 1)));
+				}
+			}
+			expire(callback);
+		}
+	}
+
+private:
+	struct Node {
+		uint32_t expires;
+		uint16_t next;
+		uint16_t prev;
+		uint8_t slot;
+		bool active;
+	};
+
+	/*
+	 * Place a node in the appropriate slot for its expiry time
+	 */
+	void link(unsigned index)
+	{
+		auto& node = nodes[index];
+		auto delta = int32_t(node.expires - current);
+		unsigned slot;
+		if(delta <= 0) {
+			// Due now: only happens when cascading or rebasing
+			slot = current & (slotCount - 1);
+		} else {
+			unsigned level = 0;
+			while(level < levels && uint32_t(delta) >> ((level + 1) * levelBits) != 0) {
+				++level;
+			}
+			if(level == levels) {
+				// Out of range: park in slot before current, which is reached after a full rotation
+				--level;
+				auto shift = level * levelBits;
+				slot = level * slotCount + (((current >> shift) - 1) & (slotCount - 1));
+			} else {
+				slot = level * slotCount + ((node.expires >> (level * levelBits)) & (slotCount - 1));
+			}
+		}
+
+		node.slot = slot;
+		node.prev = none;
+		node.next = heads[slot];
+		if(node.next != none) {
+			nodes[node.next].prev = index;
+		}
+		heads[slot] = index;
+	}
+
+	void unlink(unsigned index)
+	{
+		auto& node = nodes[index];
+		if(node.prev == none) {
+			heads[node.slot] = node.next;
+		} else {
+			nodes[node.prev].next = node.next;
+		}
+		if(node.next != none) {
+			nodes[node.next].prev = node.prev;
+		}
+	}
+
+	void cascade(unsigned slot)
+	{
+		auto index = heads[slot];
+		heads[slot] = none;
+		while(index != none) {
+			auto next = nodes[index].next;
+			link(index);
+			index = next;
+		}
+	}
+
+	template <typename Callback> void expire(Callback& callback)
+	{
+		auto slot = current & (slotCount - 1);
+		uint16_t index;
+		// Callbacks may modify the wheel, so always take from the head
+		while((index = heads[slot]) != none) {
+			remove(index);
+			callback(index);
+		}
+	}
+
+	template <typename Callback> void rebase(uint32_t now, Callback& callback)
+	{
+		for(auto& head : heads) {
+			head = none;
+		}
+		current = now;
+		for(unsigned i = 0; i < size; ++i) {
+			if(nodes[i].active) {
+				link(i);
+			}
+		}
+		expire(callback);
+	}
+
+	uint16_t heads[levels * slotCount];
+	Node nodes[size]{};
+	uint32_t current{0};
+	uint16_t count{0};
+};
+
+} // namespace Hue
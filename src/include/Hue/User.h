@@ -0,0 +1,43 @@
+/****
+ * User.h - Information about API users
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "RateLimiter.h"
+#include <WHashMap.h>
+#include <WString.h>
+
+namespace Hue
+{
+/**
+ * @brief Information about user
+ */
+struct User {
+	String deviceType;		///< How the user identifies themselves
+	uint16_t count{0};		///< Number of requests received from this user
+	bool authorized{false}; ///< Only authorized users may perform actions
+	TokenBucket rateBucket; ///< Limits request rate from this user
+};
+
+/**
+ * @brief List of users, key is user name
+ */
+using UserMap = HashMap<String, User>;
+
+} // namespace Hue
@@ -0,0 +1,114 @@
+/****
+ * UserJournal.h - Append-only persistent store for authorized users
+ *
+ * Copyright 2019 mikee47 <mike@sillyhouse.net>
+ *
+ * This file is part of the HueEmulator Library
+ *
+ * This library is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU General Public License as published by the Free Software Foundation, version 3 or later.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this library.
+ * If not, see <https://www.gnu.org/licenses/>.
+ *
+ ****/
+
+#pragma once
+
+#include "User.h"
+
+/**
+ * @brief Journal is compacted once it holds this many records more than there are authorized users
+ */
+#ifndef HUE_JOURNAL_COMPACT_THRESHOLD
+#define HUE_JOURNAL_COMPACT_THRESHOLD 32
+#endif
+
+namespace Hue
+{
+/**
+ * @brief Stores user authorizations as a journal in flash
+ *
+ * Each authorize or revoke action appends a small record to the file, rather than rewriting
+ * the whole user list. When enough superseded records have accumulated the file is compacted,
+ * so it never grows much beyond the set of currently authorized users and replay at startup
+ * stays quick.
+ *
+ * Each record carries a checksum. Replay stops at the first bad record, so an interrupted
+ * write loses only that record. An interrupted compaction is completed or discarded on replay.
+ */
+class UserJournal
+{
+public:
+	enum class RecordType : uint8_t {
+		authorize = 'A',
+		revoke = 'R',
+	};
+
+	/**
+	 * @brief Set the file to use
+	 * @param filename
+	 */
+	void open(const String& filename)
+	{
+		this->filename = filename;
+		recordCount = 0;
+	}
+
+	bool isOpen() const
+	{
+		return filename.length() != 0;
+	}
+
+	/**
+	 * @brief Read all records from the journal, applying them to a user list
+	 * @param users
+	 * @retval bool false if the journal was damaged; it will be compacted
+	 */
+	bool replay(UserMap& users);
+
+	/**
+	 * @brief Add a record to the journal
+	 * @param type
+	 * @param name User name
+	 * @param deviceType
+	 * @param users Current user list, required if the journal needs compacting
+	 * @retval bool true on success
+	 */
+	bool append(RecordType type, const String& name, const String& deviceType, const UserMap& users);
+
+	/**
+	 * @brief Rewrite the journal so it contains only authorized users
+	 * @param users
+	 * @retval bool true on success
+	 */
+	bool compact(const UserMap& users);
+
+	/**
+	 * @brief Get number of records in the journal
+	 */
+	unsigned getRecordCount() const
+	{
+		return recordCount;
+	}
+
+private:
+	String getTempName() const
+	{
+		return filename + ".tmp";
+	}
+
+	/*
+	 * Complete or discard a compaction which was interrupted
+	 */
+	void recover();
+
+	String filename;
+	unsigned recordCount{0};
+};
+
+} // namespace Hue